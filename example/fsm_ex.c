@@ -117,8 +117,11 @@ static const fsm_event_t ex_events[] = {
     },
 };
 
+static fsm_name_index_t ex_event_index;
+
 const fsm_event_list_t ex_event_list = {.length = ARRAY_SIZE(ex_events),
-                                        .events = ex_events};
+                                        .events = ex_events,
+                                        .index = &ex_event_index};
 
 static const fsm_state_t ex_states[EX_FSM_STATE_NUM] = {
     {
@@ -151,5 +154,8 @@ static const fsm_state_t ex_states[EX_FSM_STATE_NUM] = {
     },
 };
 
+static fsm_name_index_t ex_state_index;
+
 const fsm_state_list_t ex_state_list = {.length = ARRAY_SIZE(ex_states),
-                                        .states = ex_states};
+                                        .states = ex_states,
+                                        .index = &ex_state_index};
@@ -32,6 +32,7 @@
 #include "fsm.h"
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -51,6 +52,15 @@ const fsm_pseudo_state_t FSM_TERMINATE_STATE = {
  */
 static void fsm_final_state_default_cb(void) {}
 
+/**
+ * @brief true if `state` defers `event_id`
+ *
+ */
+static bool fsm_defers(const fsm_state_t *state, int event_id) {
+  unsigned id = (unsigned)event_id;
+  return state->defer && (state->defer[id / 32] & (UINT32_C(1) << (id % 32)));
+}
+
 static void fsm_print_states(fsm_t *fsm, FILE *stream, const fsm_state_t *state,
                              int *ids) {
 
@@ -65,7 +75,12 @@ static void fsm_print_states(fsm_t *fsm, FILE *stream, const fsm_state_t *state,
 
     const fsm_event_t *event = &fsm->event_list->events[i];
 
-    const fsm_state_t *nxt_state = state->transition.guard(event);
+    if (fsm_defers(state, event->id)) {
+      fprintf(stream, "    %s : %s / defer\r\n", state->name, event->name);
+      continue;
+    }
+
+    const fsm_state_t *nxt_state = fsm_transition_next(state, event, NULL);
     if (nxt_state == (const fsm_state_t *)&FSM_TERMINATE_STATE) {
       fprintf(stream, "   %s --> [*]: %s[%s]\r\n", state->name, event->name,
               state->transition.name);
@@ -80,10 +95,216 @@ static void fsm_print_states(fsm_t *fsm, FILE *stream, const fsm_state_t *state,
   }
 }
 
+/**
+ * @brief list of the waiters awaiting `state`, or any transition for NULL
+ *
+ */
+static fsm_waiter_t **fsm_wait_list(fsm_t *fsm, const fsm_state_t *state) {
+
+  if (state == NULL) {
+    return &fsm->waiters;
+  }
+
+  // the states of a list are consecutive, so are their lists
+  return &fsm->buckets[((uintptr_t)state / sizeof(fsm_state_t)) %
+                             FSM_WAIT_BUCKETS];
+}
+
+/**
+ * @brief move the waiters of a list awaiting `state`, all of them for NULL,
+ * to `ready`
+ *
+ */
+static void fsm_wait_take(fsm_t *fsm, fsm_waiter_t **link,
+                          const fsm_state_t *state, fsm_waiter_t **ready) {
+
+  while (*link) {
+    fsm_waiter_t *waiter = *link;
+    if (state == NULL || waiter->state == state) {
+      *link = waiter->next;
+      waiter->next = *ready;
+      *ready = waiter;
+      fsm->waiting--;
+    } else {
+      link = &waiter->next;
+    }
+  }
+}
+
+/**
+ * @brief resume the waiters satisfied by the current state
+ *
+ */
+static void fsm_notify(fsm_t *fsm) {
+
+  const fsm_state_t *state = fsm->cur_state;
+  fsm_waiter_t *ready = NULL;
+
+  // unlink first, resumed waiters are allowed to wait again
+  if (state == (const fsm_state_t *)&FSM_TERMINATE_STATE) {
+    for (size_t b = 0; b < FSM_WAIT_BUCKETS; b++) {
+      fsm_wait_take(fsm, &fsm->buckets[b], NULL, &ready);
+    }
+  } else {
+    fsm_wait_take(fsm, fsm_wait_list(fsm, state), state, &ready);
+  }
+  fsm_wait_take(fsm, &fsm->waiters, NULL, &ready);
+
+  while (ready) {
+    fsm_waiter_t *waiter = ready;
+    ready = waiter->next;
+    waiter->next = NULL;
+    waiter->resume(waiter, state);
+  }
+}
+
+static const fsm_state_t *fsm_row_list_next(const fsm_row_list_t *row_list,
+                                            const fsm_event_t *event,
+                                            const fsm_row_t **row) {
+
+  unsigned id = (unsigned)event->id;
+
+  if (row_list->handled &&
+      !(row_list->handled[id / 32] & (UINT32_C(1) << (id % 32)))) {
+    return NULL;
+  }
+
+  // lower bound of event id
+  size_t lo = 0;
+  size_t hi = row_list->length;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (row_list->rows[mid].event_id < event->id) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  for (; lo < row_list->length; lo++) {
+    const fsm_row_t *cur = &row_list->rows[lo];
+    if (cur->event_id != event->id) {
+      break;
+    }
+    if (cur->guard == NULL || cur->guard(event)) {
+      if (row) {
+        *row = cur;
+      }
+      return cur->target;
+    }
+  }
+
+  return NULL;
+}
+
+const fsm_state_t *fsm_transition_next(const fsm_state_t *state,
+                                       const fsm_event_t *event,
+                                       const fsm_row_t **row) {
+
+  if (state->transition.guard) {
+    return state->transition.guard(event);
+  }
+
+  if (state->transition.row_list) {
+    return fsm_row_list_next(state->transition.row_list, event, row);
+  }
+
+  return NULL;
+}
+
+bool fsm_state_list_defers(const fsm_state_list_t *state_list) {
+
+  for (size_t i = 0; i < state_list->length; i++) {
+    if (state_list->states[i].defer) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void fsm_row_list_index(const fsm_state_list_t *state_list,
+                        const fsm_event_list_t *event_list) {
+
+  size_t words = FSM_EVENT_MASK_WORDS(event_list->length);
+
+  for (size_t i = 0; i < state_list->length; i++) {
+
+    const transition_t *transition = &state_list->states[i].transition;
+    const fsm_row_list_t *row_list = transition->row_list;
+
+    if (transition->guard || row_list == NULL ||
+        row_list->handled == NULL) {
+      continue;
+    }
+
+    // the mask is shared by every instance of the definition: once filled
+    // it is never written again
+    bool filled = false;
+    for (size_t w = 0; w < words && !filled; w++) {
+      filled = row_list->handled[w] != 0;
+    }
+    if (filled) {
+      continue;
+    }
+
+    for (size_t j = 0; j < row_list->length; j++) {
+      unsigned id = (unsigned)row_list->rows[j].event_id;
+      assert(id < event_list->length);
+      assert(j == 0 ||
+             row_list->rows[j - 1].event_id <= row_list->rows[j].event_id);
+      row_list->handled[id / 32] |= UINT32_C(1) << (id % 32);
+    }
+  }
+}
+
 int fsm_event_put(fsm_t *fsm, const fsm_event_t *event) {
   return queue_put(&fsm->queue, event->id) ? -1 : event->id;
 }
 
+int fsm_event_put_by_name(fsm_t *fsm, const char *name) {
+
+  const fsm_event_t *event = fsm_event_by_name(fsm, name);
+
+  return event ? fsm_event_put(fsm, event) : -1;
+}
+
+const fsm_event_t *fsm_event_by_name(const fsm_t *fsm, const char *name) {
+
+  const fsm_event_list_t *event_list = fsm->event_list;
+
+  if (event_list->index && event_list->index->base) {
+    int pos = fsm_name_index_find(event_list->index, name);
+    return pos < 0 ? NULL : &event_list->events[pos];
+  }
+
+  for (size_t i = 0; i < event_list->length; i++) {
+    if (!strcmp(event_list->events[i].name, name)) {
+      return &event_list->events[i];
+    }
+  }
+
+  return NULL;
+}
+
+const fsm_state_t *fsm_state_by_name(const fsm_t *fsm, const char *name) {
+
+  const fsm_state_list_t *state_list = fsm->state_list;
+
+  if (state_list->index && state_list->index->base) {
+    int pos = fsm_name_index_find(state_list->index, name);
+    return pos < 0 ? NULL : &state_list->states[pos];
+  }
+
+  for (size_t i = 0; i < state_list->length; i++) {
+    if (!strcmp(state_list->states[i].name, name)) {
+      return &state_list->states[i];
+    }
+  }
+
+  return NULL;
+}
+
 void fsm_print(fsm_t *fsm, FILE *stream) {
 
   int *ids = (int *)malloc(fsm->state_list->length * sizeof(int));
@@ -109,62 +330,187 @@ void fsm_register_final_state_callback(fsm_t *fsm,
       final_state_cb ? final_state_cb : fsm_final_state_default_cb;
 }
 
-void fsm_mainloop(fsm_t *fsm) {
-
-  int event_id;
+/**
+ * @brief enter the initial state on first use
+ *
+ */
+static void fsm_start(fsm_t *fsm, bool trace) {
 
   if (fsm->cur_state == (const fsm_state_t *)&FSM_INITIAL_STATE) {
-    fprintf(stderr, "info: fsm `%s`, %s state\r\n", fsm->name,
-            FSM_INITIAL_STATE.name);
+    if (trace) {
+      fprintf(stderr, "info: fsm `%s`, %s state\r\n", fsm->name,
+              FSM_INITIAL_STATE.name);
+    }
     fsm->cur_state = fsm->init_state;
     if (fsm->cur_state->on_entry) {
       fsm->cur_state->on_entry();
     }
+    if (fsm->waiting) {
+      fsm_notify(fsm);
+    }
   }
+}
 
-  while (!queue_get(&fsm->queue, &event_id)) {
+/**
+ * @brief process one event
+ *
+ * @return true if the machine is terminated
+ */
+static bool fsm_step(fsm_t *fsm, int event_id, bool trace) {
 
-    if ((size_t)event_id >= fsm->event_list->length) {
-      fprintf(stderr, "warning: fsm `%s`, unknown event id %d\r\n", fsm->name,
-              event_id);
-      continue;
-    }
+  if ((size_t)event_id >= fsm->event_list->length) {
+    fprintf(stderr, "warning: fsm `%s`, unknown event id %d\r\n", fsm->name,
+            event_id);
+    return false;
+  }
 
-    const fsm_event_t *event = &fsm->event_list->events[event_id];
+  const fsm_event_t *event = &fsm->event_list->events[event_id];
 
+  if (trace) {
     fprintf(stderr, "info: fsm `%s`, received event `%s`\r\n", fsm->name,
             event->name);
+  }
 
-    if (fsm->cur_state == (const fsm_state_t *)&FSM_TERMINATE_STATE) {
-      return;
+  if (fsm->cur_state == (const fsm_state_t *)&FSM_TERMINATE_STATE) {
+    return true;
+  }
+
+  if (fsm_defers(fsm->cur_state, event_id)) {
+    if (queue_put(&fsm->deferred, event_id)) {
+      fprintf(stderr, "warning: fsm `%s`, deferred events queue full\r\n",
+              fsm->name);
+    } else if (trace) {
+      fprintf(stderr, "info: fsm `%s`, %s deferred `%s`\r\n", fsm->name,
+              fsm->cur_state->name, event->name);
     }
+    return false;
+  }
 
-    const fsm_state_t *nxt_state = fsm->cur_state->transition.guard(event);
+  const fsm_row_t *row = NULL;
+  const fsm_state_t *nxt_state =
+      fsm_transition_next(fsm->cur_state, event, &row);
 
-    if (nxt_state == NULL) {
-      continue;
-    }
+  if (nxt_state == NULL) {
+    return false;
+  }
 
+  if (trace) {
     fprintf(stderr, "info: fsm `%s`, %s -[%s]-> %s\r\n", fsm->name,
             fsm->cur_state->name, event->name, nxt_state->name);
+  }
 
-    if (fsm->cur_state->on_exit) {
-      fsm->cur_state->on_exit();
-    }
+  if (fsm->cur_state->on_exit) {
+    fsm->cur_state->on_exit();
+  }
 
-    fsm->cur_state = nxt_state;
+  if (row && row->action) {
+    row->action(event);
+  }
 
-    if (fsm->cur_state == (const fsm_state_t *)&FSM_TERMINATE_STATE) {
+  fsm->cur_state = nxt_state;
+
+  if (fsm->cur_state == (const fsm_state_t *)&FSM_TERMINATE_STATE) {
+    if (trace) {
       fprintf(stderr, "info: fsm `%s`, %s state\r\n", fsm->name,
               FSM_TERMINATE_STATE.name);
-      fsm->final_state_cb();
+    }
+    fsm->final_state_cb();
+    if (fsm->waiting) {
+      fsm_notify(fsm);
+    }
+    return true;
+  }
+
+  if (fsm->cur_state->on_entry) {
+    fsm->cur_state->on_entry();
+  }
+
+  if (fsm->waiting) {
+    fsm_notify(fsm);
+  }
+
+  return false;
+}
+
+/**
+ * @brief process one event, then the deferred events while the state changes
+ *
+ * @return true if the machine is terminated
+ */
+static bool fsm_process(fsm_t *fsm, int event_id, bool trace) {
+
+  const fsm_state_t *state = fsm->cur_state;
+
+  if (fsm_step(fsm, event_id, trace)) {
+    return true;
+  }
+
+  while (fsm->cur_state != state && !queue_is_empty(&fsm->deferred)) {
+
+    state = fsm->cur_state;
+
+    // one pass in order, events still deferred go back to the tail
+    for (size_t i = queue_size(&fsm->deferred); i > 0; i--) {
+      queue_get(&fsm->deferred, &event_id);
+      if (fsm_defers(fsm->cur_state, event_id)) {
+        queue_put(&fsm->deferred, event_id);
+      } else if (fsm_step(fsm, event_id, trace)) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+void fsm_mainloop(fsm_t *fsm) {
+
+  int event_id;
+
+  fsm_start(fsm, true);
+
+  while (!queue_get(&fsm->queue, &event_id)) {
+    if (fsm_process(fsm, event_id, true)) {
       return;
     }
+  }
+}
 
-    if (fsm->cur_state->on_entry) {
-      fsm->cur_state->on_entry();
+size_t fsm_dispatch(fsm_t *fsm, const int *event_ids, size_t length) {
+
+  fsm_start(fsm, false);
+
+  for (size_t i = 0; i < length; i++) {
+    if (fsm_process(fsm, event_ids[i], false)) {
+      return i + 1;
     }
   }
+
+  return length;
+}
+
+void fsm_wait(fsm_t *fsm, fsm_waiter_t *waiter) {
+
+  fsm_waiter_t **list = fsm_wait_list(fsm, waiter->state);
+
+  waiter->next = *list;
+  *list = waiter;
+  fsm->waiting++;
+}
+
+int fsm_wait_cancel(fsm_t *fsm, fsm_waiter_t *waiter) {
+
+  for (fsm_waiter_t **link = fsm_wait_list(fsm, waiter->state); *link;
+       link = &(*link)->next) {
+    if (*link == waiter) {
+      *link = waiter->next;
+      waiter->next = NULL;
+      fsm->waiting--;
+      return 0;
+    }
+  }
+
+  return -1;
 }
 
 void fsm_init(fsm_t *fsm, const char *name, const fsm_state_list_t *state_list,
@@ -181,7 +527,30 @@ void fsm_init(fsm_t *fsm, const char *name, const fsm_state_list_t *state_list,
 
   fsm->event_list = event_list;
 
+  fsm_row_list_index(state_list, event_list);
+
+  if (event_list->index) {
+    fsm_name_index_build_once(event_list->index, event_list->events,
+                              event_list->length, sizeof(fsm_event_t),
+                              offsetof(fsm_event_t, name));
+  }
+
+  if (state_list->index) {
+    fsm_name_index_build_once(state_list->index, state_list->states,
+                              state_list->length, sizeof(fsm_state_t),
+                              offsetof(fsm_state_t, name));
+  }
+
   fsm->final_state_cb = fsm_final_state_default_cb;
 
+  fsm->waiters = NULL;
+
+  memset(fsm->buckets, 0, sizeof(fsm->buckets));
+
+  fsm->waiting = 0;
+
   queue_wrap(&fsm->queue, fsm->queue_buf, ARRAY_SIZE(fsm->queue_buf));
+
+  queue_wrap(&fsm->deferred, fsm->deferred_buf,
+             ARRAY_SIZE(fsm->deferred_buf));
 }
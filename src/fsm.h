@@ -36,15 +36,28 @@
 extern "C" {
 #endif
 
+#include "fsm_index.h"
 #include "queue.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #ifndef FSM_EVENT_QUEUE_SIZE
 #define FSM_EVENT_QUEUE_SIZE (8) /**< */
 #endif
 
+#ifndef FSM_DEFER_QUEUE_SIZE
+#define FSM_DEFER_QUEUE_SIZE FSM_EVENT_QUEUE_SIZE /**< */
+#endif
+
+#ifndef FSM_WAIT_BUCKETS
+#define FSM_WAIT_BUCKETS (16) /**< lists of waiters awaiting a state */
+#endif
+
+#define FSM_EVENT_MASK_WORDS(event_count)                                      \
+  (((event_count) + 31) / 32) /**< words of a handled events bitmask */
+
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(array) (sizeof(array) / sizeof(array[0]))
 #endif
@@ -65,6 +78,7 @@ typedef struct fsm_event_s {
 typedef struct fsm_event_list_s {
   size_t length;             /**< */
   const fsm_event_t *events; /**< */
+  fsm_name_index_t *index;   /**< optional, built by `fsm_init` */
 } fsm_event_list_t;
 
 /**
@@ -81,11 +95,39 @@ typedef struct fsm_state_s fsm_state_t;
 
 /**
  * @brief
- *
+ * Declarative transition row: on `event_id`, if `guard` is NULL or returns
+ * true, `action` is performed between the exit and entry actions and the
+ * machine moves to `target`.
+ */
+typedef struct fsm_row_s {
+  int event_id;                             /**< */
+  const fsm_state_t *target;                /**< */
+  bool (*guard)(const fsm_event_t *event);  /**< optional */
+  void (*action)(const fsm_event_t *event); /**< optional */
+} fsm_row_t;
+
+/**
+ * @brief
+ * Transition rows of a state, sorted by `event_id`. Rows sharing an event id
+ * are evaluated in order. `handled` points to FSM_EVENT_MASK_WORDS(number of
+ * events) zeroed words filled by the first `fsm_init`, an event whose bit is
+ * clear is rejected without searching the rows.
+ */
+typedef struct fsm_row_list_s {
+  size_t length;         /**< */
+  const fsm_row_t *rows; /**< */
+  uint32_t *handled;     /**< */
+} fsm_row_list_t;
+
+/**
+ * @brief
+ * A state transition is either described by a `guard` function returning the
+ * next state, or, when `guard` is NULL, by declarative `row_list`.
  */
 typedef struct transition_s {
   const char *name;                                 /**< */
   const fsm_state_t *(*guard)(const fsm_event_t *); /**< */
+  const fsm_row_list_t *row_list;                   /**< */
 } transition_t;
 
 /**
@@ -109,6 +151,10 @@ typedef struct fsm_state_s {
   // void (*on_going)(void);  /**< action performed as long as in the state*/
   void (*on_exit)(void);   /**< action performed upon exit from the state*/
   transition_t transition; /**< */
+  const uint32_t *defer;   /**< optional, FSM_EVENT_MASK_WORDS(number of
+                              events) words, events held while in the state
+                              and delivered once a state not deferring them
+                              is entered */
 } fsm_state_t;
 
 /**
@@ -118,21 +164,43 @@ typedef struct fsm_state_s {
 typedef struct fsm_state_list_s {
   size_t length;             /**< */
   const fsm_state_t *states; /**< */
+  fsm_name_index_t *index;   /**< optional, built by `fsm_init` */
 } fsm_state_list_t;
 
+/**
+ * @brief
+ * Intrusive waiter resumed from `fsm_mainloop` once the machine enters the
+ * awaited state. The storage is owned by the caller and no allocation is done
+ * by the finite state machine.
+ */
+typedef struct fsm_waiter_s fsm_waiter_t;
+
+struct fsm_waiter_s {
+  fsm_waiter_t *next;       /**< */
+  const fsm_state_t *state; /**< state awaited, NULL for any transition */
+  void (*resume)(fsm_waiter_t *waiter,
+                 const fsm_state_t *state); /**< called once, then unlinked */
+  void *ctx;                                /**< */
+};
+
 /**
  * @brief Definition of the finite state machine struct
  *
  */
 struct fsm_s {
-  const char *name;                    /**< */
-  const fsm_state_t *cur_state;        /**< */
-  const fsm_state_t *init_state;       /**< */
-  const fsm_state_list_t *state_list;  /**< */
-  const fsm_event_list_t *event_list;  /**< */
-  void (*final_state_cb)(void);        /**< */
-  int queue_buf[FSM_EVENT_QUEUE_SIZE]; /**< */
-  queue_t queue;                       /**< */
+  const char *name;                        /**< */
+  const fsm_state_t *cur_state;            /**< */
+  const fsm_state_t *init_state;           /**< */
+  const fsm_state_list_t *state_list;      /**< */
+  const fsm_event_list_t *event_list;      /**< */
+  void (*final_state_cb)(void);            /**< */
+  int queue_buf[FSM_EVENT_QUEUE_SIZE];     /**< */
+  queue_t queue;                           /**< */
+  fsm_waiter_t *waiters;                   /**< awaiting any transition */
+  fsm_waiter_t *buckets[FSM_WAIT_BUCKETS]; /**< awaiting a state, by hash */
+  size_t waiting;                          /**< registered waiters */
+  int deferred_buf[FSM_DEFER_QUEUE_SIZE];  /**< */
+  queue_t deferred;                        /**< held events, in order */
 };
 
 extern const fsm_pseudo_state_t FSM_TERMINATE_STATE;
@@ -147,6 +215,34 @@ extern const fsm_pseudo_state_t FSM_TERMINATE_STATE;
  */
 int fsm_event_put(fsm_t *fsm, const fsm_event_t *event);
 
+/**
+ * @brief puts the event named `name` into internal events queue
+ *
+ * @param fsm the finate state machine struct
+ * @param name the event name
+ * @return int Upon successful completion event id is returned.  Otherwise, -1
+ * is returned
+ */
+int fsm_event_put_by_name(fsm_t *fsm, const char *name);
+
+/**
+ * @brief Look up an event by name, in O(1) when the event list has an index
+ *
+ * @param fsm the finate state machine struct
+ * @param name the event name
+ * @return const fsm_event_t* the event, NULL if not found
+ */
+const fsm_event_t *fsm_event_by_name(const fsm_t *fsm, const char *name);
+
+/**
+ * @brief Look up a state by name, in O(1) when the state list has an index
+ *
+ * @param fsm the finate state machine struct
+ * @param name the state name
+ * @return const fsm_state_t* the state, NULL if not found
+ */
+const fsm_state_t *fsm_state_by_name(const fsm_t *fsm, const char *name);
+
 /**
  * @brief
  *
@@ -170,6 +266,76 @@ void fsm_register_final_state_callback(fsm_t *fsm,
  */
 void fsm_mainloop(fsm_t *fsm);
 
+/**
+ * @brief Process a batch of events directly, bypassing the internal events
+ * queue and the per event info traces
+ *
+ * @param fsm the finite state machine struct
+ * @param event_ids the events ids
+ * @param length number of events
+ * @return size_t number of events consumed, less than `length` if the machine
+ * terminated
+ */
+size_t fsm_dispatch(fsm_t *fsm, const int *event_ids, size_t length);
+
+/**
+ * @brief Register a waiter resumed from `fsm_mainloop` on the next entry into
+ * `waiter->state`, or on the next transition when `waiter->state` is NULL.
+ * All waiters are resumed with `FSM_TERMINATE_STATE` when the machine
+ * terminates. A waiter may register itself again from its resume callback.
+ * Waiters are kept in one list per hash of the awaited state and one list for
+ * any transition, a transition only visits the lists it can resume.
+ *
+ * @param fsm the finite state machine struct
+ * @param waiter the waiter, `state`, `resume` and `ctx` set by the caller
+ */
+void fsm_wait(fsm_t *fsm, fsm_waiter_t *waiter);
+
+/**
+ * @brief Unlink a waiter which has not been resumed yet
+ *
+ * @param fsm the finite state machine struct
+ * @param waiter the waiter
+ * @return int 0 if the waiter was pending, -1 otherwise
+ */
+int fsm_wait_cancel(fsm_t *fsm, fsm_waiter_t *waiter);
+
+/**
+ * @brief Whether a state of the list defers events. Deferral needs the
+ * deferred events queue of `fsm_t`, the tabulated forms of a definition
+ * (`fsm_table_t`, images, product and Markov analyses) and the composite and
+ * swappable machines reject such definitions.
+ *
+ * @param state_list
+ * @return true if a state has a `defer` bitmask
+ */
+bool fsm_state_list_defers(const fsm_state_list_t *state_list);
+
+/**
+ * @brief Fill the handled events bitmask of the states described by rows.
+ * Called by `fsm_init`, the rows must be sorted by event id. Only masks still
+ * all zero are filled, a non zero mask is taken as built and never written,
+ * so that instances of the same definition can be initialised while others
+ * are running. A mask precomputed by the user must match the rows.
+ *
+ * @param state_list
+ * @param event_list
+ */
+void fsm_row_list_index(const fsm_state_list_t *state_list,
+                        const fsm_event_list_t *event_list);
+
+/**
+ * @brief Next state of `state` upon `event`
+ *
+ * @param state
+ * @param event
+ * @param row the matching row if any, may be NULL
+ * @return const fsm_state_t* the next state, NULL if the event is not handled
+ */
+const fsm_state_t *fsm_transition_next(const fsm_state_t *state,
+                                       const fsm_event_t *event,
+                                       const fsm_row_t **row);
+
 /**
  * @brief Initialise finite state machine struct
  *
@@ -0,0 +1,154 @@
+/**
+ * @file fsm_coro.hpp
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _FSM_CORO_HPP
+#define _FSM_CORO_HPP
+
+#include "fsm.h"
+
+#include <coroutine>
+#include <exception>
+
+namespace fsm {
+
+/**
+ * @brief
+ * Awaitable resumed directly from the transition path of `fsm_mainloop`,
+ * the awaiting coroutine runs on the thread stepping the machine.
+ * `co_await` yields the state entered, `FSM_TERMINATE_STATE` if the machine
+ * terminated first.
+ */
+class state_awaiter {
+public:
+  state_awaiter(fsm_t *fsm, const fsm_state_t *state) : fsm_(fsm) {
+    waiter_.next = nullptr;
+    waiter_.state = state;
+    waiter_.resume = &state_awaiter::on_resume;
+    waiter_.ctx = this;
+  }
+
+  state_awaiter(const state_awaiter &) = delete;
+  state_awaiter &operator=(const state_awaiter &) = delete;
+
+  bool await_ready() const noexcept {
+    return waiter_.state != nullptr && fsm_->cur_state == waiter_.state;
+  }
+
+  void await_suspend(std::coroutine_handle<> handle) noexcept {
+    handle_ = handle;
+    fsm_wait(fsm_, &waiter_);
+  }
+
+  const fsm_state_t *await_resume() const noexcept {
+    return entered_ ? entered_ : fsm_->cur_state;
+  }
+
+private:
+  static void on_resume(fsm_waiter_t *waiter, const fsm_state_t *state) {
+    state_awaiter *self = static_cast<state_awaiter *>(waiter->ctx);
+    self->entered_ = state;
+    self->handle_.resume();
+  }
+
+  fsm_t *fsm_;
+  fsm_waiter_t waiter_;
+  std::coroutine_handle<> handle_;
+  const fsm_state_t *entered_ = nullptr;
+};
+
+/**
+ * @brief
+ * Coroutine view over an initialised `fsm_t`
+ */
+class machine {
+public:
+  explicit machine(fsm_t *fsm) : fsm_(fsm) {}
+
+  /**
+   * @brief resumes on the next entry into `state`, immediately if already in
+   * it
+   */
+  state_awaiter enter(const fsm_state_t *state) const {
+    return state_awaiter(fsm_, state);
+  }
+
+  /**
+   * @brief resumes after the next transition
+   */
+  state_awaiter next_transition() const {
+    return state_awaiter(fsm_, nullptr);
+  }
+
+  int put(const fsm_event_t *event) const { return fsm_event_put(fsm_, event); }
+
+  void step() const { fsm_mainloop(fsm_); }
+
+  bool terminated() const {
+    return fsm_->cur_state ==
+           reinterpret_cast<const fsm_state_t *>(&FSM_TERMINATE_STATE);
+  }
+
+  fsm_t *get() const { return fsm_; }
+
+private:
+  fsm_t *fsm_;
+};
+
+/**
+ * @brief
+ * Fire-and-forget coroutine, the frame is released when the body returns.
+ */
+struct task {
+  struct promise_type {
+    task get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+/**
+ * @brief Executor adapter: step the machine each time `executor.schedule()`
+ * resumes the coroutine, until the machine terminates.
+ *
+ * @tparam Executor any type whose `schedule()` returns an awaitable
+ */
+template <typename Executor> task drive(machine m, Executor &executor) {
+  while (!m.terminated()) {
+    co_await executor.schedule();
+    m.step();
+  }
+}
+
+} // namespace fsm
+
+#endif /* _FSM_CORO_HPP */
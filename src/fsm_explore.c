@@ -0,0 +1,458 @@
+/**
+ * @file fsm_explore.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_explore.h"
+#include "fsm_table.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FSM_EXPLORE_CHUNK (256)     /**< frontier states claimed at once */
+#define FSM_EXPLORE_LOAD (0.875)    /**< maximum visited set load factor */
+#define FSM_EXPLORE_NONE UINT32_MAX /**< */
+
+typedef struct fsm_explorer_s {
+  size_t count;        /**< number of machines */
+  fsm_table_t *tables; /**< */
+  unsigned *shift;     /**< bit offset of each machine in a key */
+  uint64_t *mask;      /**< */
+  uint64_t terminated; /**< key with every machine terminated */
+  size_t events;       /**< size of the product alphabet */
+  const char **names;  /**< */
+  int *local;          /**< local[event * count + machine], -1 if unknown */
+  unsigned checks;     /**< */
+
+  size_t capacity;           /**< power of two */
+  size_t limit;              /**< */
+  _Atomic(uint64_t) *keys;   /**< key + 1, 0 when empty */
+  uint32_t *parent;          /**< */
+  uint32_t *event;           /**< */
+  uint32_t *frontier[2];     /**< */
+  size_t cur;                /**< */
+  size_t cur_length;         /**< */
+  atomic_size_t next_length; /**< */
+  atomic_size_t cursor;      /**< */
+  atomic_size_t visited;     /**< */
+  size_t depth;              /**< */
+  bool done;                 /**< */
+  atomic_int result;         /**< */
+  uint32_t violation;        /**< */
+  atomic_bool go;            /**< */
+  pthread_barrier_t barrier; /**< */
+} fsm_explorer_t;
+
+static uint64_t fsm_explore_hash(uint64_t h) {
+  h = (h ^ (h >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  h = (h ^ (h >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return h ^ (h >> 31);
+}
+
+static uint32_t fsm_explore_component(const fsm_explorer_t *ex, uint64_t key,
+                                      size_t i) {
+  return (uint32_t)((key >> ex->shift[i]) & ex->mask[i]);
+}
+
+static void fsm_explore_report(fsm_explorer_t *ex, fsm_explore_result_t result,
+                               uint32_t slot) {
+
+  int expected = FSM_EXPLORE_OK;
+
+  if (atomic_compare_exchange_strong(&ex->result, &expected, (int)result)) {
+    ex->violation = slot;
+  }
+}
+
+/**
+ * @brief add a state to the visited set and to the next frontier
+ *
+ * @return uint32_t the slot of the new state, FSM_EXPLORE_NONE if already
+ * visited or the budget is exhausted
+ */
+static uint32_t fsm_explore_insert(fsm_explorer_t *ex, uint64_t key,
+                                   uint32_t parent, uint32_t event) {
+
+  size_t mask = ex->capacity - 1;
+  size_t slot = fsm_explore_hash(key) & mask;
+  size_t probes = 0;
+
+  // probe first, a state already visited never counts against the budget
+  for (;;) {
+    uint64_t cur = atomic_load_explicit(&ex->keys[slot], memory_order_relaxed);
+
+    if (cur == key + 1) {
+      return FSM_EXPLORE_NONE;
+    }
+
+    if (cur == 0) {
+      // a new state, only stored while under the limit
+      if (atomic_load(&ex->visited) >= ex->limit) {
+        break;
+      }
+      if (atomic_compare_exchange_strong(&ex->keys[slot], &cur, key + 1)) {
+        ex->parent[slot] = parent;
+        ex->event[slot] = event;
+        // the slot is ours, concurrent claims overshoot the limit by at most
+        // one state per thread
+        if (atomic_fetch_add(&ex->visited, 1) >= ex->limit) {
+          break;
+        }
+
+        uint32_t *next = ex->frontier[ex->cur ^ 1];
+        next[atomic_fetch_add(&ex->next_length, 1)] = (uint32_t)slot;
+
+        return (uint32_t)slot;
+      }
+      // claimed meanwhile, check the same slot again
+      continue;
+    }
+
+    if (++probes == ex->capacity) {
+      break;
+    }
+
+    slot = (slot + 1) & mask;
+  }
+
+  fsm_explore_report(ex, FSM_EXPLORE_BUDGET, FSM_EXPLORE_NONE);
+
+  return FSM_EXPLORE_NONE;
+}
+
+static void fsm_explore_expand(fsm_explorer_t *ex, uint32_t slot) {
+
+  uint64_t key =
+      atomic_load_explicit(&ex->keys[slot], memory_order_relaxed) - 1;
+  bool progress = false;
+
+  for (size_t e = 0; e < ex->events; e++) {
+
+    uint64_t nxt = key;
+    bool terminate = false;
+
+    for (size_t i = 0; i < ex->count; i++) {
+      int local = ex->local[e * ex->count + i];
+      if (local < 0) {
+        continue;
+      }
+      const fsm_table_t *table = &ex->tables[i];
+      uint32_t s = fsm_explore_component(ex, key, i);
+      uint32_t n = table->next[s * table->events + (size_t)local];
+      if (n != s) {
+        nxt &= ~(ex->mask[i] << ex->shift[i]);
+        nxt |= (uint64_t)n << ex->shift[i];
+        terminate |= n == table->states;
+      }
+    }
+
+    if (nxt == key) {
+      continue;
+    }
+
+    progress = true;
+
+    uint32_t child = fsm_explore_insert(ex, nxt, slot, (uint32_t)e);
+
+    if (child != FSM_EXPLORE_NONE && terminate &&
+        (ex->checks & FSM_EXPLORE_CHECK_TERMINATE)) {
+      fsm_explore_report(ex, FSM_EXPLORE_TERMINATE, child);
+    }
+  }
+
+  if (!progress && key != ex->terminated &&
+      (ex->checks & FSM_EXPLORE_CHECK_DEADLOCK)) {
+    fsm_explore_report(ex, FSM_EXPLORE_DEADLOCK, slot);
+  }
+}
+
+static void *fsm_explore_worker(void *arg) {
+
+  fsm_explorer_t *ex = (fsm_explorer_t *)arg;
+
+  while (!atomic_load(&ex->go)) {
+    sched_yield();
+  }
+
+  for (;;) {
+    const uint32_t *cur = ex->frontier[ex->cur];
+    size_t i;
+
+    while ((i = atomic_fetch_add(&ex->cursor, FSM_EXPLORE_CHUNK)) <
+               ex->cur_length &&
+           atomic_load_explicit(&ex->result, memory_order_relaxed) ==
+               FSM_EXPLORE_OK) {
+      size_t end = i + FSM_EXPLORE_CHUNK;
+      if (end > ex->cur_length) {
+        end = ex->cur_length;
+      }
+      for (; i < end; i++) {
+        fsm_explore_expand(ex, cur[i]);
+      }
+    }
+
+    // level synchronisation, one thread swaps the frontiers
+    if (pthread_barrier_wait(&ex->barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+      ex->cur ^= 1;
+      ex->cur_length = atomic_load(&ex->next_length);
+      atomic_store(&ex->next_length, 0);
+      atomic_store(&ex->cursor, 0);
+      ex->depth++;
+      ex->done = ex->cur_length == 0 || atomic_load(&ex->result);
+    }
+    pthread_barrier_wait(&ex->barrier);
+
+    if (ex->done) {
+      return NULL;
+    }
+  }
+}
+
+static int fsm_explore_alphabet(fsm_explorer_t *ex,
+                                const fsm_t *const *machines) {
+
+  size_t total = 0;
+
+  for (size_t i = 0; i < ex->count; i++) {
+    total += machines[i]->event_list->length;
+  }
+
+  ex->names = (const char **)malloc((total ? total : 1) * sizeof(char *));
+  ex->local = (int *)malloc((total ? total : 1) * ex->count * sizeof(int));
+  if (ex->names == NULL || ex->local == NULL) {
+    return -1;
+  }
+
+  ex->events = 0;
+  for (size_t i = 0; i < ex->count; i++) {
+    const fsm_event_list_t *event_list = machines[i]->event_list;
+    for (size_t e = 0; e < event_list->length; e++) {
+      const char *name = event_list->events[e].name;
+      size_t g;
+      for (g = 0; g < ex->events; g++) {
+        if (!strcmp(ex->names[g], name)) {
+          break;
+        }
+      }
+      if (g == ex->events) {
+        ex->names[ex->events++] = name;
+        for (size_t j = 0; j < ex->count; j++) {
+          ex->local[g * ex->count + j] = -1;
+        }
+      }
+      ex->local[g * ex->count + i] = (int)e;
+    }
+  }
+
+  return 0;
+}
+
+static void fsm_explore_trace(fsm_explorer_t *ex, const fsm_t *const *machines,
+                              fsm_explore_report_t *report) {
+
+  uint32_t slot = ex->violation;
+  size_t length = 0;
+
+  for (uint32_t s = slot; ex->parent[s] != FSM_EXPLORE_NONE;
+       s = ex->parent[s]) {
+    length++;
+  }
+
+  report->trace =
+      (const char **)malloc((length ? length : 1) * sizeof(char *));
+  report->violation =
+      (const fsm_state_t **)malloc(ex->count * sizeof(fsm_state_t *));
+  if (report->trace == NULL || report->violation == NULL) {
+    return;
+  }
+
+  report->trace_length = length;
+  for (uint32_t s = slot; ex->parent[s] != FSM_EXPLORE_NONE;
+       s = ex->parent[s]) {
+    report->trace[--length] = ex->names[ex->event[s]];
+  }
+
+  uint64_t key = atomic_load(&ex->keys[slot]) - 1;
+  for (size_t i = 0; i < ex->count; i++) {
+    uint32_t s = fsm_explore_component(ex, key, i);
+    report->violation[i] = s == ex->tables[i].states
+                               ? (const fsm_state_t *)&FSM_TERMINATE_STATE
+                               : &machines[i]->state_list->states[s];
+  }
+}
+
+static void fsm_explore_free(fsm_explorer_t *ex) {
+
+  for (size_t i = 0; ex->tables && i < ex->count; i++) {
+    fsm_table_free(&ex->tables[i]);
+  }
+
+  free(ex->tables);
+  free(ex->shift);
+  free(ex->mask);
+  free(ex->names);
+  free(ex->local);
+  free(ex->keys);
+  free(ex->parent);
+  free(ex->event);
+  free(ex->frontier[0]);
+  free(ex->frontier[1]);
+}
+
+fsm_explore_result_t fsm_explore(const fsm_t *const *machines, size_t count,
+                                 unsigned checks, size_t threads,
+                                 size_t memory_budget,
+                                 fsm_explore_report_t *report) {
+
+  fsm_explorer_t ex;
+  unsigned bits = 0;
+
+  memset(&ex, 0, sizeof(ex));
+  memset(report, 0, sizeof(*report));
+  report->result = FSM_EXPLORE_ERROR;
+
+  ex.count = count;
+  ex.checks = checks;
+  ex.tables = (fsm_table_t *)calloc(count ? count : 1, sizeof(fsm_table_t));
+  ex.shift = (unsigned *)calloc(count ? count : 1, sizeof(unsigned));
+  ex.mask = (uint64_t *)calloc(count ? count : 1, sizeof(uint64_t));
+
+  if (count == 0 || !ex.tables || !ex.shift || !ex.mask ||
+      fsm_explore_alphabet(&ex, machines)) {
+    goto out;
+  }
+
+  uint64_t initial = 0;
+  for (size_t i = 0; i < count; i++) {
+    const fsm_t *fsm = machines[i];
+    if (fsm_table_build(&ex.tables[i], fsm->state_list, fsm->event_list)) {
+      goto out;
+    }
+    unsigned width = 1;
+    while ((UINT64_C(1) << width) < fsm->state_list->length + 1) {
+      width++;
+    }
+    ex.shift[i] = bits;
+    ex.mask[i] = (UINT64_C(1) << width) - 1;
+    bits += width;
+    if (bits > 63) {
+      goto out;
+    }
+    initial |= (uint64_t)(fsm->init_state - fsm->state_list->states)
+               << ex.shift[i];
+    ex.terminated |= (uint64_t)fsm->state_list->length << ex.shift[i];
+  }
+
+  // key, parent, event and two frontier entries per slot
+  size_t per_slot = sizeof(uint64_t) + 4 * sizeof(uint32_t);
+  ex.capacity = 1;
+  while (ex.capacity * 2 * per_slot <= memory_budget &&
+         ex.capacity * 2 <= UINT32_MAX) {
+    ex.capacity *= 2;
+  }
+  ex.limit = (size_t)((double)ex.capacity * FSM_EXPLORE_LOAD);
+
+  ex.keys = (_Atomic(uint64_t) *)calloc(ex.capacity, sizeof(uint64_t));
+  ex.parent = (uint32_t *)malloc(ex.capacity * sizeof(uint32_t));
+  ex.event = (uint32_t *)malloc(ex.capacity * sizeof(uint32_t));
+  ex.frontier[0] = (uint32_t *)malloc(ex.capacity * sizeof(uint32_t));
+  ex.frontier[1] = (uint32_t *)malloc(ex.capacity * sizeof(uint32_t));
+  if (!ex.keys || !ex.parent || !ex.event || !ex.frontier[0] ||
+      !ex.frontier[1] || ex.limit < 1) {
+    goto out;
+  }
+
+  atomic_init(&ex.result, FSM_EXPLORE_OK);
+  atomic_init(&ex.visited, 0);
+  atomic_init(&ex.cursor, 0);
+  atomic_init(&ex.next_length, 0);
+  ex.cur = 1; // insert the initial state into frontier 0
+  fsm_explore_insert(&ex, initial, FSM_EXPLORE_NONE, FSM_EXPLORE_NONE);
+  ex.cur = 0;
+  ex.cur_length = atomic_exchange(&ex.next_length, 0);
+
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (size_t)cpus : 1;
+  }
+
+  pthread_t *workers = (pthread_t *)malloc(threads * sizeof(pthread_t));
+  if (workers == NULL) {
+    goto out;
+  }
+
+  // workers wait for the barrier to be sized on the threads actually started
+  atomic_init(&ex.go, false);
+  size_t started;
+  for (started = 1; started < threads; started++) {
+    if (pthread_create(&workers[started], NULL, fsm_explore_worker, &ex)) {
+      break;
+    }
+  }
+
+  pthread_barrier_init(&ex.barrier, NULL, (unsigned)started);
+  atomic_store(&ex.go, true);
+
+  fsm_explore_worker(&ex);
+
+  for (size_t t = 1; t < started; t++) {
+    pthread_join(workers[t], NULL);
+  }
+
+  pthread_barrier_destroy(&ex.barrier);
+  free(workers);
+
+  report->result = (fsm_explore_result_t)atomic_load(&ex.result);
+  report->states = atomic_load(&ex.visited);
+  report->depth = ex.depth;
+
+  if (report->result == FSM_EXPLORE_DEADLOCK ||
+      report->result == FSM_EXPLORE_TERMINATE) {
+    fsm_explore_trace(&ex, machines, report);
+  }
+
+out:
+  fsm_explore_free(&ex);
+
+  return report->result;
+}
+
+void fsm_explore_report_free(fsm_explore_report_t *report) {
+  free(report->trace);
+  free(report->violation);
+  report->trace = NULL;
+  report->violation = NULL;
+  report->trace_length = 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file fsm_explore.h
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _FSM_EXPLORE_H
+#define _FSM_EXPLORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "fsm.h"
+
+#include <stddef.h>
+
+#define FSM_EXPLORE_CHECK_DEADLOCK (1u << 0)  /**< */
+#define FSM_EXPLORE_CHECK_TERMINATE (1u << 1) /**< */
+
+/**
+ * @brief
+ *
+ */
+typedef enum fsm_explore_result_e {
+  FSM_EXPLORE_OK = 0,    /**< every reachable state visited, no violation */
+  FSM_EXPLORE_DEADLOCK,  /**< a state from which no event makes progress */
+  FSM_EXPLORE_TERMINATE, /**< a machine reached FSM_TERMINATE_STATE */
+  FSM_EXPLORE_BUDGET,    /**< the memory budget is exhausted */
+  FSM_EXPLORE_ERROR,     /**< invalid definitions or allocation failure */
+} fsm_explore_result_t;
+
+/**
+ * @brief
+ *
+ */
+typedef struct fsm_explore_report_s {
+  fsm_explore_result_t result; /**< */
+  size_t states;               /**< number of product states visited */
+  size_t depth;                /**< number of BFS levels completed */
+  size_t trace_length;         /**< */
+  const char **trace; /**< event names leading from the initial states to the
+                         violation, shortest such trace */
+  const fsm_state_t **violation; /**< state of each machine at the violation */
+} fsm_explore_report_t;
+
+/**
+ * @brief Explore the product of several machines, starting from their
+ * initial states, with a multi-threaded breadth first search.
+ *
+ * Machines synchronise on event names: an event is delivered to every machine
+ * whose event list has an event of the same name, the other machines keep
+ * their state. A product state is a deadlock when no event changes it and
+ * not all machines are terminated. Guards must be pure, no action is
+ * performed. Machines with deferred events are rejected.
+ *
+ * Product states are packed into 63 bits and kept in a lock-free open
+ * addressing set sized from `memory_budget` (about 24 bytes per state).
+ *
+ * @param machines the initialised machines
+ * @param count number of machines
+ * @param checks FSM_EXPLORE_CHECK_* flags
+ * @param threads number of threads, 0 selects one per online CPU
+ * @param memory_budget bytes available for the visited set and frontiers
+ * @param report the outcome, release with `fsm_explore_report_free`
+ * @return fsm_explore_result_t `report->result`
+ */
+fsm_explore_result_t fsm_explore(const fsm_t *const *machines, size_t count,
+                                 unsigned checks, size_t threads,
+                                 size_t memory_budget,
+                                 fsm_explore_report_t *report);
+
+/**
+ * @brief
+ *
+ * @param report
+ */
+void fsm_explore_report_free(fsm_explore_report_t *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FSM_EXPLORE_H */
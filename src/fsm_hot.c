@@ -0,0 +1,397 @@
+/**
+ * @file fsm_hot.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_hot.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FSM_CACHE_LINE (64)
+#define FSM_HOT_RETIRED (1u << 31) /**< set in `instances` once retired */
+#define FSM_HOT_IDLE (0)           /**< announced epoch outside a section */
+
+struct fsm_version_s {
+  fsm_def_t def;                   /**< */
+  unsigned number;                 /**< */
+  _Atomic(fsm_version_t *) next;   /**< newer version, NULL while current */
+  atomic_uint instances;           /**< instances bound, FSM_HOT_RETIRED */
+  uint64_t retire_epoch;           /**< */
+  fsm_version_t *retired_next;     /**< */
+};
+
+typedef struct fsm_hot_worker_s {
+  _Alignas(FSM_CACHE_LINE) atomic_uint_fast64_t epoch; /**< */
+} fsm_hot_worker_t;
+
+struct fsm_hot_s {
+  _Atomic(fsm_version_t *) current; /**< */
+  atomic_uint_fast64_t epoch;       /**< */
+  size_t workers;                   /**< */
+  fsm_hot_worker_t *worker;         /**< */
+  pthread_mutex_t mutex;            /**< serialises swaps and reclaims */
+  fsm_version_t *oldest;            /**< oldest version not retired */
+  fsm_version_t *retired;           /**< retired, not yet released */
+};
+
+static fsm_version_t *fsm_version_new(const fsm_def_t *def, unsigned number) {
+
+  if (fsm_state_list_defers(def->state_list)) {
+    return NULL;
+  }
+
+  fsm_version_t *version = (fsm_version_t *)calloc(1, sizeof(fsm_version_t));
+
+  if (version) {
+    version->def = *def;
+    if (version->def.init_state == NULL) {
+      version->def.init_state = &def->state_list->states[0];
+    }
+    version->number = number;
+    atomic_init(&version->next, NULL);
+    atomic_init(&version->instances, 0);
+  }
+
+  return version;
+}
+
+static void fsm_version_release(fsm_version_t *version) {
+  if (version->def.release) {
+    version->def.release(&version->def);
+  }
+  free(version);
+}
+
+static size_t fsm_version_init_index(const fsm_version_t *version) {
+  return (size_t)(version->def.init_state - version->def.state_list->states);
+}
+
+/**
+ * @brief take a reference on `version` unless it is retired
+ */
+static bool fsm_version_ref(fsm_version_t *version) {
+
+  unsigned count = atomic_load(&version->instances);
+
+  while (!(count & FSM_HOT_RETIRED)) {
+    if (atomic_compare_exchange_weak(&version->instances, &count,
+                                     count + 1)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief state index in `to` of the state `state` of the version it replaces
+ */
+static size_t fsm_version_map(const fsm_version_t *from,
+                              const fsm_version_t *to, size_t state) {
+
+  const fsm_def_t *def = &to->def;
+
+  if (state == from->def.state_list->length) {
+    return def->state_list->length;
+  }
+
+  if (state < def->map_length && def->state_map[state] >= 0 &&
+      (size_t)def->state_map[state] < def->state_list->length) {
+    return (size_t)def->state_map[state];
+  }
+
+  return fsm_version_init_index(to);
+}
+
+/**
+ * @brief move an instance to the newest version, mapping its state through
+ * every version in between
+ */
+static void fsm_hot_migrate(fsm_hot_instance_t *instance) {
+
+  fsm_version_t *from = instance->version;
+  fsm_version_t *to = atomic_load(&from->next);
+
+  if (to == NULL) {
+    return;
+  }
+
+  // versions newer than a referenced one are never retired before it
+  size_t state = instance->state;
+
+  for (;;) {
+    state = fsm_version_map(from, to, state);
+    from = to;
+    to = atomic_load(&from->next);
+    if (to == NULL) {
+      if (fsm_version_ref(from)) {
+        break;
+      }
+      to = atomic_load(&from->next);
+    }
+  }
+
+  atomic_fetch_sub(&instance->version->instances, 1);
+  instance->version = from;
+  instance->state = state;
+}
+
+fsm_hot_t *fsm_hot_create(const fsm_def_t *def, size_t workers) {
+
+  fsm_hot_t *hot = (fsm_hot_t *)calloc(1, sizeof(fsm_hot_t));
+  if (hot == NULL) {
+    return NULL;
+  }
+
+  hot->worker = (fsm_hot_worker_t *)aligned_alloc(
+      FSM_CACHE_LINE, (workers ? workers : 1) * sizeof(fsm_hot_worker_t));
+  fsm_version_t *version = fsm_version_new(def, 0);
+
+  if (hot->worker == NULL || version == NULL) {
+    free(hot->worker);
+    free(version);
+    free(hot);
+    return NULL;
+  }
+
+  for (size_t w = 0; w < workers; w++) {
+    atomic_init(&hot->worker[w].epoch, FSM_HOT_IDLE);
+  }
+
+  hot->workers = workers;
+  atomic_init(&hot->epoch, 1);
+  atomic_init(&hot->current, version);
+  hot->oldest = version;
+  hot->retired = NULL;
+  pthread_mutex_init(&hot->mutex, NULL);
+
+  return hot;
+}
+
+void fsm_hot_destroy(fsm_hot_t *hot) {
+
+  if (hot == NULL) {
+    return;
+  }
+
+  for (fsm_version_t *version = hot->retired; version;) {
+    fsm_version_t *next = version->retired_next;
+    fsm_version_release(version);
+    version = next;
+  }
+
+  for (fsm_version_t *version = hot->oldest; version;) {
+    fsm_version_t *next = atomic_load(&version->next);
+    fsm_version_release(version);
+    version = next;
+  }
+
+  pthread_mutex_destroy(&hot->mutex);
+  free(hot->worker);
+  free(hot);
+}
+
+void fsm_hot_enter(fsm_hot_t *hot, size_t worker) {
+  atomic_store(&hot->worker[worker].epoch, atomic_load(&hot->epoch));
+}
+
+void fsm_hot_leave(fsm_hot_t *hot, size_t worker) {
+  atomic_store_explicit(&hot->worker[worker].epoch, FSM_HOT_IDLE,
+                        memory_order_release);
+}
+
+void fsm_hot_attach(fsm_hot_t *hot, fsm_hot_instance_t *instance) {
+
+  fsm_version_t *version = atomic_load(&hot->current);
+
+  // a version retired meanwhile is not released before this section ends
+  while (!fsm_version_ref(version)) {
+    version = atomic_load(&version->next);
+  }
+
+  instance->version = version;
+  instance->state = fsm_version_init_index(version);
+
+  if (version->def.init_state->on_entry) {
+    version->def.init_state->on_entry();
+  }
+}
+
+void fsm_hot_detach(fsm_hot_t *hot, fsm_hot_instance_t *instance) {
+
+  (void)hot;
+
+  atomic_fetch_sub(&instance->version->instances, 1);
+  instance->version = NULL;
+}
+
+int fsm_hot_dispatch(fsm_hot_t *hot, fsm_hot_instance_t *instance,
+                     int event_id) {
+
+  (void)hot;
+
+  fsm_hot_migrate(instance);
+
+  const fsm_def_t *def = &instance->version->def;
+  const fsm_state_list_t *state_list = def->state_list;
+
+  if (event_id < 0 || (size_t)event_id >= def->event_list->length) {
+    return -1;
+  }
+
+  if (instance->state == state_list->length) {
+    return 0;
+  }
+
+  const fsm_event_t *event = &def->event_list->events[event_id];
+  const fsm_state_t *cur_state = &state_list->states[instance->state];
+  const fsm_row_t *row = NULL;
+  const fsm_state_t *nxt_state = fsm_transition_next(cur_state, event, &row);
+
+  if (nxt_state == NULL) {
+    return 0;
+  }
+
+  if (cur_state->on_exit) {
+    cur_state->on_exit();
+  }
+
+  if (row && row->action) {
+    row->action(event);
+  }
+
+  if (nxt_state == (const fsm_state_t *)&FSM_TERMINATE_STATE) {
+    instance->state = state_list->length;
+    return 1;
+  }
+
+  instance->state = (size_t)(nxt_state - state_list->states);
+
+  if (nxt_state->on_entry) {
+    nxt_state->on_entry();
+  }
+
+  return 1;
+}
+
+const fsm_state_t *fsm_hot_state(fsm_hot_t *hot,
+                                 fsm_hot_instance_t *instance) {
+
+  (void)hot;
+
+  fsm_hot_migrate(instance);
+
+  const fsm_state_list_t *state_list = instance->version->def.state_list;
+
+  if (instance->state == state_list->length) {
+    return (const fsm_state_t *)&FSM_TERMINATE_STATE;
+  }
+
+  return &state_list->states[instance->state];
+}
+
+int fsm_hot_swap(fsm_hot_t *hot, const fsm_def_t *def) {
+
+  pthread_mutex_lock(&hot->mutex);
+
+  fsm_version_t *current = atomic_load(&hot->current);
+  fsm_version_t *version = fsm_version_new(def, current->number + 1);
+
+  if (version == NULL) {
+    pthread_mutex_unlock(&hot->mutex);
+    return -1;
+  }
+
+  // publish the link first, instances migrate through it
+  atomic_store(&current->next, version);
+  atomic_store(&hot->current, version);
+
+  pthread_mutex_unlock(&hot->mutex);
+
+  fsm_hot_reclaim(hot);
+
+  return (int)version->number;
+}
+
+size_t fsm_hot_reclaim(fsm_hot_t *hot) {
+
+  size_t alive = 0;
+
+  pthread_mutex_lock(&hot->mutex);
+
+  fsm_version_t *current = atomic_load(&hot->current);
+
+  // retire from the oldest end so that the chain of every instance is kept
+  while (hot->oldest != current) {
+    unsigned unused = 0;
+    if (!atomic_compare_exchange_strong(&hot->oldest->instances, &unused,
+                                        FSM_HOT_RETIRED)) {
+      break;
+    }
+    fsm_version_t *version = hot->oldest;
+    hot->oldest = atomic_load(&version->next);
+    version->retire_epoch = atomic_fetch_add(&hot->epoch, 1) + 1;
+    version->retired_next = hot->retired;
+    hot->retired = version;
+  }
+
+  // oldest epoch a worker is still in
+  uint64_t min = UINT64_MAX;
+  for (size_t w = 0; w < hot->workers; w++) {
+    uint64_t epoch = atomic_load(&hot->worker[w].epoch);
+    if (epoch != FSM_HOT_IDLE && epoch < min) {
+      min = epoch;
+    }
+  }
+
+  for (fsm_version_t **link = &hot->retired; *link;) {
+    fsm_version_t *version = *link;
+    if (version->retire_epoch <= min) {
+      *link = version->retired_next;
+      fsm_version_release(version);
+    } else {
+      link = &version->retired_next;
+      alive++;
+    }
+  }
+
+  for (fsm_version_t *version = hot->oldest; version;
+       version = atomic_load(&version->next)) {
+    alive++;
+  }
+
+  pthread_mutex_unlock(&hot->mutex);
+
+  return alive;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file fsm_hot.h
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _FSM_HOT_H
+#define _FSM_HOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "fsm.h"
+
+#include <stddef.h>
+
+/**
+ * @brief
+ * A version of a machine definition, owned by the caller until `release` is
+ * called once no worker can observe it any more.
+ */
+typedef struct fsm_def_s {
+  const fsm_state_list_t *state_list; /**< */
+  const fsm_event_list_t *event_list; /**< */
+  const fsm_state_t *init_state;      /**< NULL for the first state */
+  const int *state_map;  /**< state index in the previous version -> state
+                            index in this one, -1 resets to `init_state` */
+  size_t map_length;     /**< */
+  void (*release)(const struct fsm_def_s *def); /**< optional */
+  void *ctx;                                    /**< */
+} fsm_def_t;
+
+/**
+ * @brief
+ *
+ */
+typedef struct fsm_version_s fsm_version_t;
+
+/**
+ * @brief
+ * Swappable definition shared by many instances. Event processing is lock
+ * free: workers announce an epoch around it (RCU style), a replaced version is
+ * retired once no instance refers to it any more and released once every
+ * worker has left the epoch in which it was retired.
+ */
+typedef struct fsm_hot_s fsm_hot_t;
+
+/**
+ * @brief
+ * Machine instance of a swappable definition, keeping its state as an index
+ * so that it can move to a newer version on its next event.
+ */
+typedef struct fsm_hot_instance_s {
+  fsm_version_t *version; /**< */
+  size_t state;           /**< index in the state list, its length once
+                             terminated */
+} fsm_hot_instance_t;
+
+/**
+ * @brief Instances keep no deferred events queue, definitions with deferred
+ * events are rejected
+ *
+ * @param def the first version, copied
+ * @param workers number of workers processing events
+ * @return fsm_hot_t* NULL on failure
+ */
+fsm_hot_t *fsm_hot_create(const fsm_def_t *def, size_t workers);
+
+/**
+ * @brief Release every version, no worker may be inside a section
+ *
+ * @param hot
+ */
+void fsm_hot_destroy(fsm_hot_t *hot);
+
+/**
+ * @brief Begin a section in which `worker` may use the instances
+ *
+ * @param hot
+ * @param worker the worker number
+ */
+void fsm_hot_enter(fsm_hot_t *hot, size_t worker);
+
+/**
+ * @brief End the section of `worker`
+ *
+ * @param hot
+ * @param worker the worker number
+ */
+void fsm_hot_leave(fsm_hot_t *hot, size_t worker);
+
+/**
+ * @brief Bind an instance to the current version and enter its initial state,
+ * inside a section
+ *
+ * @param hot
+ * @param instance
+ */
+void fsm_hot_attach(fsm_hot_t *hot, fsm_hot_instance_t *instance);
+
+/**
+ * @brief Unbind an instance, inside a section
+ *
+ * @param hot
+ * @param instance
+ */
+void fsm_hot_detach(fsm_hot_t *hot, fsm_hot_instance_t *instance);
+
+/**
+ * @brief Process an event of the current version, inside a section. The
+ * instance first moves to the current version if a swap happened.
+ *
+ * @param hot
+ * @param instance
+ * @param event_id
+ * @return int 1 if a transition happened, 0 if not, -1 on unknown event
+ */
+int fsm_hot_dispatch(fsm_hot_t *hot, fsm_hot_instance_t *instance,
+                     int event_id);
+
+/**
+ * @brief Current state of an instance, inside a section
+ *
+ * @param hot
+ * @param instance
+ * @return const fsm_state_t* the state, `FSM_TERMINATE_STATE` if terminated
+ */
+const fsm_state_t *fsm_hot_state(fsm_hot_t *hot,
+                                 fsm_hot_instance_t *instance);
+
+/**
+ * @brief Publish a new version, `def->state_map` maps the state indexes of
+ * the version it replaces. Swaps are serialised, workers are never blocked.
+ * Definitions with deferred events are rejected.
+ *
+ * @param hot
+ * @param def the new version, copied
+ * @return int the version number, -1 on failure
+ */
+int fsm_hot_swap(fsm_hot_t *hot, const fsm_def_t *def);
+
+/**
+ * @brief Retire the versions no instance refers to and release the retired
+ * versions no worker can observe. Also done by every swap.
+ *
+ * @param hot
+ * @return size_t number of versions still alive, the current one included
+ */
+size_t fsm_hot_reclaim(fsm_hot_t *hot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FSM_HOT_H */
@@ -0,0 +1,474 @@
+/**
+ * @file fsm_image.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "fsm_image.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint32_t fsm_image_checksum(const uint8_t *buf, size_t size) {
+
+  // FNV-1a
+  uint32_t h = UINT32_C(2166136261);
+
+  for (size_t i = 0; i < size; i++) {
+    h ^= buf[i];
+    h *= UINT32_C(16777619);
+  }
+
+  return h;
+}
+
+/**
+ * @brief sort `index` by name, stable
+ *
+ */
+static void fsm_image_sort(uint32_t *index, uint32_t *tmp, size_t length,
+                           const char *strings, const uint32_t *names) {
+
+  if (length < 2) {
+    return;
+  }
+
+  size_t half = length / 2;
+
+  fsm_image_sort(index, tmp, half, strings, names);
+  fsm_image_sort(index + half, tmp, length - half, strings, names);
+
+  size_t i = 0;
+  size_t j = half;
+  size_t k = 0;
+
+  while (i < half && j < length) {
+    if (strcmp(&strings[names[index[j]]], &strings[names[index[i]]]) < 0) {
+      tmp[k++] = index[j++];
+    } else {
+      tmp[k++] = index[i++];
+    }
+  }
+  while (i < half) {
+    tmp[k++] = index[i++];
+  }
+  while (j < length) {
+    tmp[k++] = index[j++];
+  }
+
+  memcpy(index, tmp, length * sizeof(uint32_t));
+}
+
+static uint32_t fsm_image_string(char *strings, size_t *length,
+                                 const char *name) {
+
+  uint32_t offset = (uint32_t)*length;
+  size_t size = strlen(name) + 1;
+
+  memcpy(&strings[*length], name, size);
+  *length += size;
+
+  return offset;
+}
+
+static size_t fsm_image_align(size_t size) { return (size + 3) & ~(size_t)3; }
+
+int fsm_image_write(FILE *stream, const char *name,
+                    const fsm_state_list_t *state_list,
+                    const fsm_state_t *init_state,
+                    const fsm_event_list_t *event_list) {
+
+  size_t states = state_list->length;
+  size_t events = event_list->length;
+  size_t rows = 0;
+  size_t string_size = strlen(name) + 1;
+
+  if (fsm_state_list_defers(state_list)) {
+    return -1;
+  }
+
+  for (size_t s = 0; s < states; s++) {
+    string_size += strlen(state_list->states[s].name) + 1;
+    for (size_t e = 0; e < events; e++) {
+      if (fsm_transition_next(&state_list->states[s], &event_list->events[e],
+                              NULL)) {
+        rows++;
+      }
+    }
+  }
+
+  for (size_t e = 0; e < events; e++) {
+    string_size += strlen(event_list->events[e].name) + 1;
+  }
+
+  fsm_image_header_t header = {
+      .magic = FSM_IMAGE_MAGIC,
+      .version = FSM_IMAGE_VERSION,
+      .byte_order = FSM_IMAGE_BYTE_ORDER,
+      .states = (uint32_t)states,
+      .events = (uint32_t)events,
+      .rows = (uint32_t)rows,
+      .init_state =
+          init_state ? (uint32_t)(init_state - state_list->states) : 0,
+  };
+
+  size_t offset = sizeof(fsm_image_header_t);
+  header.state_offset = (uint32_t)offset;
+  offset += states * sizeof(fsm_image_state_t);
+  header.event_offset = (uint32_t)offset;
+  offset += events * sizeof(fsm_image_event_t);
+  header.row_offset = (uint32_t)offset;
+  offset += rows * sizeof(fsm_image_row_t);
+  header.state_sorted_offset = (uint32_t)offset;
+  offset += states * sizeof(uint32_t);
+  header.event_sorted_offset = (uint32_t)offset;
+  offset += events * sizeof(uint32_t);
+  header.string_offset = (uint32_t)offset;
+  header.string_size = (uint32_t)string_size;
+  offset = fsm_image_align(offset + string_size);
+
+  if (offset > UINT32_MAX || states > INT32_MAX || events > INT32_MAX) {
+    return -1;
+  }
+
+  header.size = (uint32_t)offset;
+
+  uint8_t *buf = (uint8_t *)calloc(1, offset);
+  size_t count = states + events + 1;
+  uint32_t *names = (uint32_t *)malloc(count * sizeof(uint32_t));
+  uint32_t *tmp = (uint32_t *)malloc(count * sizeof(uint32_t));
+
+  if (buf == NULL || names == NULL || tmp == NULL) {
+    free(buf);
+    free(names);
+    free(tmp);
+    return -1;
+  }
+
+  fsm_image_state_t *state = (fsm_image_state_t *)&buf[header.state_offset];
+  fsm_image_event_t *event = (fsm_image_event_t *)&buf[header.event_offset];
+  fsm_image_row_t *row = (fsm_image_row_t *)&buf[header.row_offset];
+  uint32_t *state_sorted = (uint32_t *)&buf[header.state_sorted_offset];
+  uint32_t *event_sorted = (uint32_t *)&buf[header.event_sorted_offset];
+  char *strings = (char *)&buf[header.string_offset];
+  size_t string_length = 0;
+  size_t r = 0;
+  int res = 0;
+
+  header.name = fsm_image_string(strings, &string_length, name);
+
+  for (size_t s = 0; s < states && res == 0; s++) {
+    state[s].id = state_list->states[s].id;
+    state[s].name =
+        fsm_image_string(strings, &string_length, state_list->states[s].name);
+    state[s].row = (uint32_t)r;
+    for (size_t e = 0; e < events; e++) {
+      const fsm_state_t *nxt = fsm_transition_next(
+          &state_list->states[s], &event_list->events[e], NULL);
+      if (nxt == NULL) {
+        continue;
+      }
+      size_t target = nxt == (const fsm_state_t *)&FSM_TERMINATE_STATE
+                          ? states
+                          : (size_t)(nxt - state_list->states);
+      if (target > states || r == rows) {
+        // not a state of the list, or a guard which is not pure
+        res = -1;
+        break;
+      }
+      row[r].event_id = (uint32_t)e;
+      row[r].target = (uint32_t)target;
+      r++;
+    }
+    state[s].rows = (uint32_t)(r - state[s].row);
+    state_sorted[s] = (uint32_t)s;
+    names[s] = state[s].name;
+  }
+
+  if (res == 0) {
+    fsm_image_sort(state_sorted, tmp, states, strings, names);
+
+    for (size_t e = 0; e < events; e++) {
+      event[e].id = event_list->events[e].id;
+      event[e].name = fsm_image_string(strings, &string_length,
+                                       event_list->events[e].name);
+      event_sorted[e] = (uint32_t)e;
+      names[e] = event[e].name;
+    }
+
+    fsm_image_sort(event_sorted, tmp, events, strings, names);
+
+    header.checksum =
+        fsm_image_checksum(&buf[sizeof(header)], offset - sizeof(header));
+    memcpy(buf, &header, sizeof(header));
+
+    if (r != rows || fwrite(buf, 1, offset, stream) != offset) {
+      res = -1;
+    }
+  }
+
+  free(buf);
+  free(names);
+  free(tmp);
+
+  return res;
+}
+
+static bool fsm_image_section(const fsm_image_header_t *header,
+                              uint32_t offset, uint64_t count,
+                              size_t element) {
+  return offset % sizeof(uint32_t) == 0 && offset >= sizeof(*header) &&
+         (uint64_t)offset + count * element <= header->size;
+}
+
+/**
+ * @brief check every record refers to something inside the image
+ *
+ */
+static bool fsm_image_verify(const fsm_image_t *image) {
+
+  const fsm_image_header_t *header = image->header;
+  const uint8_t *base = (const uint8_t *)image->base;
+
+  if (fsm_image_checksum(&base[sizeof(*header)],
+                         header->size - sizeof(*header)) != header->checksum) {
+    return false;
+  }
+
+  if (header->string_size == 0 ||
+      image->strings[header->string_size - 1] != '\0' ||
+      header->name >= header->string_size) {
+    return false;
+  }
+
+  for (uint32_t s = 0; s < header->states; s++) {
+    const fsm_image_state_t *state = &image->states[s];
+    if (state->name >= header->string_size ||
+        image->state_sorted[s] >= header->states ||
+        state->row > header->rows || state->rows > header->rows - state->row) {
+      return false;
+    }
+    for (uint32_t r = state->row; r < state->row + state->rows; r++) {
+      if (image->rows[r].event_id >= header->events ||
+          image->rows[r].target > header->states ||
+          (r > state->row &&
+           image->rows[r - 1].event_id >= image->rows[r].event_id)) {
+        return false;
+      }
+    }
+  }
+
+  for (uint32_t e = 0; e < header->events; e++) {
+    if (image->events[e].name >= header->string_size ||
+        image->event_sorted[e] >= header->events) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int fsm_image_open(fsm_image_t *image, const void *buf, size_t size,
+                   unsigned flags) {
+
+  const fsm_image_header_t *header = (const fsm_image_header_t *)buf;
+  const uint8_t *base = (const uint8_t *)buf;
+
+  memset(image, 0, sizeof(fsm_image_t));
+
+  if (size < sizeof(*header) || (uintptr_t)buf % sizeof(uint32_t) ||
+      header->magic != FSM_IMAGE_MAGIC ||
+      header->byte_order != FSM_IMAGE_BYTE_ORDER ||
+      header->version != FSM_IMAGE_VERSION || header->size > size ||
+      header->init_state >= header->states ||
+      !fsm_image_section(header, header->state_offset, header->states,
+                         sizeof(fsm_image_state_t)) ||
+      !fsm_image_section(header, header->event_offset, header->events,
+                         sizeof(fsm_image_event_t)) ||
+      !fsm_image_section(header, header->row_offset, header->rows,
+                         sizeof(fsm_image_row_t)) ||
+      !fsm_image_section(header, header->state_sorted_offset, header->states,
+                         sizeof(uint32_t)) ||
+      !fsm_image_section(header, header->event_sorted_offset, header->events,
+                         sizeof(uint32_t)) ||
+      !fsm_image_section(header, header->string_offset, header->string_size,
+                         1)) {
+    return -1;
+  }
+
+  image->base = buf;
+  image->size = header->size;
+  image->header = header;
+  image->states = (const fsm_image_state_t *)&base[header->state_offset];
+  image->events = (const fsm_image_event_t *)&base[header->event_offset];
+  image->rows = (const fsm_image_row_t *)&base[header->row_offset];
+  image->state_sorted = (const uint32_t *)&base[header->state_sorted_offset];
+  image->event_sorted = (const uint32_t *)&base[header->event_sorted_offset];
+  image->strings = (const char *)&base[header->string_offset];
+
+  if ((flags & FSM_IMAGE_VERIFY) && !fsm_image_verify(image)) {
+    memset(image, 0, sizeof(fsm_image_t));
+    return -1;
+  }
+
+  return 0;
+}
+
+int fsm_image_map(fsm_image_t *image, const char *path, unsigned flags) {
+
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+
+  memset(image, 0, sizeof(fsm_image_t));
+
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (fstat(fd, &st) || st.st_size <= 0) {
+    close(fd);
+    return -1;
+  }
+
+  void *buf = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (buf == MAP_FAILED) {
+    return -1;
+  }
+
+  if (fsm_image_open(image, buf, (size_t)st.st_size, flags)) {
+    munmap(buf, (size_t)st.st_size);
+    return -1;
+  }
+
+  // the whole file is unmapped, not only the image it starts with
+  image->size = (size_t)st.st_size;
+  image->mapped = true;
+
+  return 0;
+}
+
+void fsm_image_unmap(fsm_image_t *image) {
+
+  if (image->mapped) {
+    munmap((void *)image->base, image->size);
+  }
+
+  memset(image, 0, sizeof(fsm_image_t));
+}
+
+const char *fsm_image_name(const fsm_image_t *image) {
+  return &image->strings[image->header->name];
+}
+
+const char *fsm_image_state_name(const fsm_image_t *image, uint32_t state) {
+
+  if (state == image->header->states) {
+    return FSM_TERMINATE_STATE.name;
+  }
+
+  return &image->strings[image->states[state].name];
+}
+
+const char *fsm_image_event_name(const fsm_image_t *image, uint32_t event_id) {
+  return &image->strings[image->events[event_id].name];
+}
+
+static int fsm_image_find(const fsm_image_t *image, const uint32_t *sorted,
+                          const void *records, size_t stride,
+                          size_t name_offset, size_t length,
+                          const char *name) {
+
+  size_t lo = 0;
+  size_t hi = length;
+
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    const uint8_t *record = (const uint8_t *)records + sorted[mid] * stride;
+    uint32_t offset = *(const uint32_t *)(record + name_offset);
+    int cmp = strcmp(&image->strings[offset], name);
+    if (cmp == 0) {
+      return (int)sorted[mid];
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return -1;
+}
+
+int fsm_image_state_find(const fsm_image_t *image, const char *name) {
+  return fsm_image_find(image, image->state_sorted, image->states,
+                        sizeof(fsm_image_state_t),
+                        offsetof(fsm_image_state_t, name),
+                        image->header->states, name);
+}
+
+int fsm_image_event_find(const fsm_image_t *image, const char *name) {
+  return fsm_image_find(image, image->event_sorted, image->events,
+                        sizeof(fsm_image_event_t),
+                        offsetof(fsm_image_event_t, name),
+                        image->header->events, name);
+}
+
+int fsm_image_next(const fsm_image_t *image, uint32_t state,
+                   uint32_t event_id) {
+
+  if (state >= image->header->states) {
+    return -1;
+  }
+
+  const fsm_image_row_t *row = &image->rows[image->states[state].row];
+  size_t lo = 0;
+  size_t hi = image->states[state].rows;
+
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (row[mid].event_id == event_id) {
+      return (int)row[mid].target;
+    }
+    if (row[mid].event_id < event_id) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return -1;
+}
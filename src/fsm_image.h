@@ -0,0 +1,232 @@
+/**
+ * @file fsm_image.h
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _FSM_IMAGE_H
+#define _FSM_IMAGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "fsm.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define FSM_IMAGE_MAGIC (0x494d5346u)      /**< "FSMI" little endian */
+#define FSM_IMAGE_VERSION (1u)             /**< */
+#define FSM_IMAGE_BYTE_ORDER (0x01020304u) /**< as written by the host */
+
+#define FSM_IMAGE_VERIFY (1u << 0) /**< check the checksum and every record */
+
+/**
+ * @brief
+ * Image header. Every section is referenced by its byte offset from the start
+ * of the image and names by their offset in the string section, so that an
+ * image can be mapped at any address and shared read-only between processes.
+ */
+typedef struct fsm_image_header_s {
+  uint32_t magic;               /**< FSM_IMAGE_MAGIC */
+  uint32_t version;             /**< FSM_IMAGE_VERSION */
+  uint32_t byte_order;          /**< FSM_IMAGE_BYTE_ORDER */
+  uint32_t size;                /**< image size in bytes, header included */
+  uint32_t checksum;            /**< FNV-1a of the bytes following the header */
+  uint32_t name;                /**< machine name */
+  uint32_t states;              /**< number of states, terminate excluded */
+  uint32_t events;              /**< */
+  uint32_t rows;                /**< */
+  uint32_t init_state;          /**< */
+  uint32_t state_offset;        /**< fsm_image_state_t[states] */
+  uint32_t event_offset;        /**< fsm_image_event_t[events] */
+  uint32_t row_offset;          /**< fsm_image_row_t[rows] */
+  uint32_t state_sorted_offset; /**< uint32_t[states] sorted by name */
+  uint32_t event_sorted_offset; /**< uint32_t[events] sorted by name */
+  uint32_t string_offset;       /**< */
+  uint32_t string_size;         /**< */
+} fsm_image_header_t;
+
+/**
+ * @brief
+ *
+ */
+typedef struct fsm_image_state_s {
+  int32_t id;    /**< */
+  uint32_t name; /**< */
+  uint32_t row;  /**< first row */
+  uint32_t rows; /**< number of rows, sorted by event id */
+} fsm_image_state_t;
+
+/**
+ * @brief
+ *
+ */
+typedef struct fsm_image_event_s {
+  int32_t id;    /**< */
+  uint32_t name; /**< */
+} fsm_image_event_t;
+
+/**
+ * @brief
+ * Transition row, `target` is the number of states for `FSM_TERMINATE_STATE`
+ */
+typedef struct fsm_image_row_s {
+  uint32_t event_id; /**< */
+  uint32_t target;   /**< */
+} fsm_image_row_t;
+
+/**
+ * @brief
+ * Machine definition read in place from an image, nothing is allocated nor
+ * copied.
+ */
+typedef struct fsm_image_s {
+  const void *base;                 /**< */
+  size_t size;                      /**< */
+  bool mapped;                      /**< mapped by `fsm_image_map` */
+  const fsm_image_header_t *header; /**< */
+  const fsm_image_state_t *states;  /**< */
+  const fsm_image_event_t *events;  /**< */
+  const fsm_image_row_t *rows;      /**< */
+  const uint32_t *state_sorted;     /**< */
+  const uint32_t *event_sorted;     /**< */
+  const char *strings;              /**< */
+} fsm_image_t;
+
+/**
+ * @brief Write the image of a definition. The transitions are tabulated into
+ * rows, guards are evaluated once per (state, event) pair and must be pure.
+ * Actions are not part of the image, definitions with deferred events are
+ * rejected.
+ *
+ * @param stream
+ * @param name the machine name
+ * @param state_list
+ * @param init_state NULL for the first state
+ * @param event_list
+ * @return int 0 on success, -1 otherwise
+ */
+int fsm_image_write(FILE *stream, const char *name,
+                    const fsm_state_list_t *state_list,
+                    const fsm_state_t *init_state,
+                    const fsm_event_list_t *event_list);
+
+/**
+ * @brief Use an image held in memory. Without FSM_IMAGE_VERIFY only the
+ * header is checked, in constant time.
+ *
+ * @param image
+ * @param buf the image, aligned on 4 bytes, must outlive `image`
+ * @param size
+ * @param flags FSM_IMAGE_* flags
+ * @return int 0 on success, -1 otherwise
+ */
+int fsm_image_open(fsm_image_t *image, const void *buf, size_t size,
+                   unsigned flags);
+
+/**
+ * @brief Map an image file read-only and shared
+ *
+ * @param image
+ * @param path
+ * @param flags FSM_IMAGE_* flags
+ * @return int 0 on success, -1 otherwise
+ */
+int fsm_image_map(fsm_image_t *image, const char *path, unsigned flags);
+
+/**
+ * @brief Unmap an image mapped by `fsm_image_map`
+ *
+ * @param image
+ */
+void fsm_image_unmap(fsm_image_t *image);
+
+/**
+ * @brief
+ *
+ * @param image
+ * @return const char* the machine name
+ */
+const char *fsm_image_name(const fsm_image_t *image);
+
+/**
+ * @brief
+ *
+ * @param image
+ * @param state the state index, the number of states for terminate
+ * @return const char* the state name
+ */
+const char *fsm_image_state_name(const fsm_image_t *image, uint32_t state);
+
+/**
+ * @brief
+ *
+ * @param image
+ * @param event_id
+ * @return const char* the event name
+ */
+const char *fsm_image_event_name(const fsm_image_t *image, uint32_t event_id);
+
+/**
+ * @brief Look up a state by name, in O(log n)
+ *
+ * @param image
+ * @param name
+ * @return int the state index, -1 if not found
+ */
+int fsm_image_state_find(const fsm_image_t *image, const char *name);
+
+/**
+ * @brief Look up an event by name, in O(log n)
+ *
+ * @param image
+ * @param name
+ * @return int the event id, -1 if not found
+ */
+int fsm_image_event_find(const fsm_image_t *image, const char *name);
+
+/**
+ * @brief Next state of `state` upon `event_id`
+ *
+ * @param image
+ * @param state the state index, the number of states for terminate
+ * @param event_id
+ * @return int the next state index, -1 if the event is not handled
+ */
+int fsm_image_next(const fsm_image_t *image, uint32_t state,
+                   uint32_t event_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FSM_IMAGE_H */
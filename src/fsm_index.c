@@ -0,0 +1,228 @@
+/**
+ * @file fsm_index.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_index.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FSM_INDEX_MAX_DISP (1u << 20) /**< tries per bucket before giving up */
+
+static uint64_t fsm_index_hash(const char *name) {
+
+  // FNV-1a
+  uint64_t h = UINT64_C(0xcbf29ce484222325);
+
+  while (*name) {
+    h ^= (unsigned char)*name++;
+    h *= UINT64_C(0x100000001b3);
+  }
+
+  return h;
+}
+
+static uint32_t fsm_index_slot(uint64_t h, uint32_t disp, size_t length) {
+
+  // splitmix64 finaliser
+  h ^= (uint64_t)disp * UINT64_C(0x9e3779b97f4a7c15);
+  h = (h ^ (h >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  h = (h ^ (h >> 27)) * UINT64_C(0x94d049bb133111eb);
+  h ^= h >> 31;
+
+  return (uint32_t)(h % length);
+}
+
+static const char *fsm_index_name(const fsm_name_index_t *index,
+                                  const void *base, size_t pos) {
+  const char *item = (const char *)base + pos * index->stride;
+  return *(const char *const *)(item + index->name_offset);
+}
+
+int fsm_name_index_build(fsm_name_index_t *index, const void *base,
+                         size_t length, size_t stride, size_t name_offset) {
+
+  int res = -1;
+  size_t n = length ? length : 1;
+
+  index->base = NULL;
+  index->state = FSM_INDEX_BUILDING;
+  index->stride = stride;
+  index->name_offset = name_offset;
+  index->length = length;
+  index->buckets = length / 2 + 1;
+  index->disp = (uint32_t *)calloc(index->buckets, sizeof(uint32_t));
+  index->slots = (uint32_t *)malloc(n * sizeof(uint32_t));
+
+  uint64_t *hashes = (uint64_t *)malloc(n * sizeof(uint64_t));
+  size_t *start = (size_t *)calloc(index->buckets + 1, sizeof(size_t));
+  size_t *fill = (size_t *)malloc(index->buckets * sizeof(size_t));
+  uint32_t *members = (uint32_t *)malloc(n * sizeof(uint32_t));
+  uint32_t *order = (uint32_t *)malloc(index->buckets * sizeof(uint32_t));
+  uint32_t *tried = (uint32_t *)malloc(n * sizeof(uint32_t));
+  bool *taken = (bool *)calloc(n, sizeof(bool));
+
+  if (!index->disp || !index->slots || !hashes || !start || !fill ||
+      !members || !order || !tried || !taken) {
+    goto out;
+  }
+
+  // group the names by bucket
+  for (size_t i = 0; i < length; i++) {
+    hashes[i] = fsm_index_hash(fsm_index_name(index, base, i));
+    start[hashes[i] % index->buckets + 1]++;
+  }
+  for (size_t b = 0; b < index->buckets; b++) {
+    start[b + 1] += start[b];
+    order[b] = (uint32_t)b;
+  }
+  memcpy(fill, start, index->buckets * sizeof(size_t));
+  for (size_t i = 0; i < length; i++) {
+    members[fill[hashes[i] % index->buckets]++] = (uint32_t)i;
+  }
+
+  // place the largest buckets first
+  for (size_t i = 1; i < index->buckets; i++) {
+    uint32_t b = order[i];
+    size_t size = start[b + 1] - start[b];
+    size_t j = i;
+    while (j > 0 && start[order[j - 1] + 1] - start[order[j - 1]] < size) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = b;
+  }
+
+  for (size_t i = 0; i < index->buckets; i++) {
+
+    uint32_t b = order[i];
+    size_t first = start[b];
+    size_t size = start[b + 1] - first;
+    uint32_t disp;
+
+    if (size == 0) {
+      break;
+    }
+
+    for (disp = 0; disp < FSM_INDEX_MAX_DISP; disp++) {
+      size_t k;
+      for (k = 0; k < size; k++) {
+        uint32_t slot =
+            fsm_index_slot(hashes[members[first + k]], disp, length);
+        bool clash = taken[slot];
+        for (size_t l = 0; !clash && l < k; l++) {
+          clash = tried[l] == slot;
+        }
+        if (clash) {
+          break;
+        }
+        tried[k] = slot;
+      }
+      if (k == size) {
+        break;
+      }
+    }
+
+    if (disp == FSM_INDEX_MAX_DISP) {
+      fprintf(stderr, "warning: name index, duplicated name `%s`\r\n",
+              fsm_index_name(index, base, members[first]));
+      goto out;
+    }
+
+    index->disp[b] = disp;
+    for (size_t k = 0; k < size; k++) {
+      taken[tried[k]] = true;
+      index->slots[tried[k]] = members[first + k];
+    }
+  }
+
+  // published last, a non NULL base is a complete index
+  __atomic_store_n(&index->base, base, __ATOMIC_RELEASE);
+  __atomic_store_n(&index->state, FSM_INDEX_BUILT, __ATOMIC_RELEASE);
+  res = 0;
+
+out:
+  free(hashes);
+  free(start);
+  free(fill);
+  free(members);
+  free(order);
+  free(tried);
+  free(taken);
+
+  if (res) {
+    fsm_name_index_free(index);
+    __atomic_store_n(&index->state, FSM_INDEX_FAILED, __ATOMIC_RELEASE);
+  }
+
+  return res;
+}
+
+int fsm_name_index_build_once(fsm_name_index_t *index, const void *base,
+                              size_t length, size_t stride,
+                              size_t name_offset) {
+
+  int state = FSM_INDEX_EMPTY;
+
+  if (!__atomic_compare_exchange_n(&index->state, &state, FSM_INDEX_BUILDING,
+                                   false, __ATOMIC_ACQ_REL,
+                                   __ATOMIC_ACQUIRE)) {
+    return state == FSM_INDEX_BUILT ? 0 : -1;
+  }
+
+  return fsm_name_index_build(index, base, length, stride, name_offset);
+}
+
+int fsm_name_index_find(const fsm_name_index_t *index, const char *name) {
+
+  const void *base = __atomic_load_n(&index->base, __ATOMIC_ACQUIRE);
+
+  if (base == NULL || index->length == 0) {
+    return -1;
+  }
+
+  uint64_t h = fsm_index_hash(name);
+  uint32_t slot =
+      fsm_index_slot(h, index->disp[h % index->buckets], index->length);
+  uint32_t pos = index->slots[slot];
+
+  return strcmp(fsm_index_name(index, base, pos), name) ? -1 : (int)pos;
+}
+
+void fsm_name_index_free(fsm_name_index_t *index) {
+  free(index->disp);
+  free(index->slots);
+  index->disp = NULL;
+  index->slots = NULL;
+  index->base = NULL;
+  index->state = FSM_INDEX_EMPTY;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file fsm_index.h
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _FSM_INDEX_H
+#define _FSM_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FSM_INDEX_EMPTY (0)    /**< not built */
+#define FSM_INDEX_BUILDING (1) /**< claimed by a builder */
+#define FSM_INDEX_BUILT (2)    /**< */
+#define FSM_INDEX_FAILED (3)   /**< the build failed, not retried */
+
+/**
+ * @brief
+ * Minimal perfect hash (hash and displace) over the `name` field of an array
+ * of structs. A lookup is two hashes, two loads and a single `strcmp` to
+ * reject unknown names.
+ */
+typedef struct fsm_name_index_s {
+  const void *base;   /**< first struct, NULL until built, set last */
+  int state;          /**< FSM_INDEX_*, a zeroed index is FSM_INDEX_EMPTY */
+  size_t stride;      /**< size of a struct */
+  size_t name_offset; /**< offset of the `const char *` name in a struct */
+  size_t length;      /**< number of names */
+  size_t buckets;     /**< */
+  uint32_t *disp;     /**< displacement per bucket */
+  uint32_t *slots;    /**< position of the name hashed to each slot */
+} fsm_name_index_t;
+
+/**
+ * @brief Build the index, names must be unique. `base` is only published once
+ * the tables are complete, the outcome is recorded in `state`.
+ *
+ * @param index the index
+ * @param base the first struct of the array
+ * @param length number of structs
+ * @param stride size of a struct
+ * @param name_offset offset of the `const char *` name in a struct
+ * @return int 0 on success, -1 otherwise
+ */
+int fsm_name_index_build(fsm_name_index_t *index, const void *base,
+                         size_t length, size_t stride, size_t name_offset);
+
+/**
+ * @brief Build the index unless already built, being built or failed. The
+ * build is claimed with a CAS on `state`, so that threads initialising
+ * instances of the same definition concurrently build it once; the others
+ * go on without it until it is published.
+ *
+ * @param index the index
+ * @param base the first struct of the array
+ * @param length number of structs
+ * @param stride size of a struct
+ * @param name_offset offset of the `const char *` name in a struct
+ * @return int 0 if built, by this call or before, -1 otherwise
+ */
+int fsm_name_index_build_once(fsm_name_index_t *index, const void *base,
+                              size_t length, size_t stride,
+                              size_t name_offset);
+
+/**
+ * @brief
+ *
+ * @param index the index
+ * @param name the name to look up
+ * @return int the position of the struct named `name`, -1 if not found
+ */
+int fsm_name_index_find(const fsm_name_index_t *index, const char *name);
+
+/**
+ * @brief Release the tables of a built index, back to FSM_INDEX_EMPTY
+ *
+ * @param index the index
+ */
+void fsm_name_index_free(fsm_name_index_t *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FSM_INDEX_H */
@@ -0,0 +1,311 @@
+/**
+ * @file fsm_markov.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_markov.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief grow the sparse entries, false on allocation failure
+ *
+ */
+static bool fsm_markov_grow(fsm_markov_t *markov, size_t capacity) {
+
+  uint32_t *col =
+      (uint32_t *)realloc(markov->col, capacity * sizeof(uint32_t));
+  if (col) {
+    markov->col = col;
+  }
+
+  double *val = (double *)realloc(markov->val, capacity * sizeof(double));
+  if (val) {
+    markov->val = val;
+  }
+
+  return col && val;
+}
+
+int fsm_markov_init(fsm_markov_t *markov, const fsm_state_list_t *state_list,
+                    const fsm_event_list_t *event_list,
+                    const double *event_probability) {
+
+  size_t terminate = state_list->length;
+  size_t events = event_list->length;
+  size_t words = FSM_EVENT_MASK_WORDS(events);
+  // a state moves to at least one state, itself when nothing is handled
+  size_t capacity = terminate + 1;
+  size_t nnz = 0;
+  double *acc = NULL;
+  double sum = 0;
+  int res = -1;
+
+  memset(markov, 0, sizeof(*markov));
+
+  for (size_t e = 0; e < events; e++) {
+    if (!(event_probability[e] >= 0)) {
+      return -1;
+    }
+    sum += event_probability[e];
+  }
+
+  if (!(sum > 0) || fsm_state_list_defers(state_list)) {
+    return -1;
+  }
+
+  markov->states = terminate + 1;
+  markov->events = events;
+  markov->event_probability = (double *)malloc(events * sizeof(double));
+  markov->handled =
+      (uint32_t *)calloc(markov->states * words + 1, sizeof(uint32_t));
+  markov->row = (size_t *)malloc((markov->states + 1) * sizeof(size_t));
+  // dense accumulator of the row being built
+  acc = (double *)calloc(markov->states, sizeof(double));
+
+  if (!markov->event_probability || !markov->handled || !markov->row ||
+      !acc || !fsm_markov_grow(markov, capacity)) {
+    goto out;
+  }
+
+  for (size_t e = 0; e < events; e++) {
+    markov->event_probability[e] = event_probability[e] / sum;
+  }
+
+  // rows straight from the transitions, only the reachable states are stored
+  for (size_t s = 0; s < markov->states; s++) {
+    markov->row[s] = nnz;
+    for (size_t e = 0; e < events; e++) {
+      if (markov->event_probability[e] == 0) {
+        continue;
+      }
+      size_t n = s;
+      const fsm_state_t *nxt =
+          s == terminate ? NULL
+                         : fsm_transition_next(&state_list->states[s],
+                                               &event_list->events[e], NULL);
+      if (nxt == (const fsm_state_t *)&FSM_TERMINATE_STATE) {
+        n = terminate;
+      } else if (nxt) {
+        n = (size_t)(nxt - state_list->states);
+        if (n >= terminate) {
+          goto out;
+        }
+      }
+      if (nxt) {
+        markov->handled[s * words + e / 32] |= UINT32_C(1) << (e % 32);
+      }
+      if (acc[n] == 0) {
+        if (nnz == capacity && !fsm_markov_grow(markov, capacity *= 2)) {
+          goto out;
+        }
+        markov->col[nnz++] = (uint32_t)n;
+      }
+      acc[n] += markov->event_probability[e];
+    }
+    for (size_t k = markov->row[s]; k < nnz; k++) {
+      markov->val[k] = acc[markov->col[k]];
+      acc[markov->col[k]] = 0;
+    }
+  }
+  markov->row[markov->states] = nnz;
+
+  // give back the spare entries, a failure keeps the larger arrays
+  if (nnz < capacity) {
+    fsm_markov_grow(markov, nnz);
+  }
+
+  res = 0;
+
+out:
+  free(acc);
+  if (res) {
+    fsm_markov_free(markov);
+  }
+
+  return res;
+}
+
+void fsm_markov_free(fsm_markov_t *markov) {
+  free(markov->event_probability);
+  free(markov->handled);
+  free(markov->row);
+  free(markov->col);
+  free(markov->val);
+  memset(markov, 0, sizeof(*markov));
+}
+
+int fsm_markov_stationary(const fsm_markov_t *markov, size_t start,
+                          double *distribution, double tolerance,
+                          size_t max_iterations) {
+
+  size_t n = markov->states;
+  double *next = (double *)malloc(n * sizeof(double));
+
+  if (next == NULL || start >= n) {
+    free(next);
+    return -1;
+  }
+
+  memset(distribution, 0, n * sizeof(double));
+  distribution[start] = 1;
+
+  for (size_t it = 1; it <= max_iterations; it++) {
+
+    // lazy chain (I + P) / 2, same fixed point but aperiodic
+    for (size_t t = 0; t < n; t++) {
+      next[t] = distribution[t] / 2;
+    }
+    for (size_t s = 0; s < n; s++) {
+      double mass = distribution[s] / 2;
+      if (mass == 0) {
+        continue;
+      }
+      for (size_t k = markov->row[s]; k < markov->row[s + 1]; k++) {
+        next[markov->col[k]] += mass * markov->val[k];
+      }
+    }
+
+    double delta = 0;
+    for (size_t t = 0; t < n; t++) {
+      delta += fabs(next[t] - distribution[t]);
+      distribution[t] = next[t];
+    }
+
+    if (delta < tolerance) {
+      free(next);
+      return (int)it;
+    }
+  }
+
+  free(next);
+
+  return -1;
+}
+
+int fsm_markov_steps(const fsm_markov_t *markov, double *steps,
+                     double tolerance, size_t max_iterations) {
+
+  size_t n = markov->states;
+  size_t terminate = n - 1;
+  bool *reach = (bool *)calloc(n, sizeof(bool));
+
+  if (reach == NULL) {
+    return -1;
+  }
+
+  // states with a path to terminate, fixed point on the sparse rows
+  reach[terminate] = true;
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (size_t s = 0; s < n; s++) {
+      for (size_t k = markov->row[s]; !reach[s] && k < markov->row[s + 1];
+           k++) {
+        if (reach[markov->col[k]]) {
+          reach[s] = changed = true;
+        }
+      }
+    }
+  }
+
+  // the expectation is only finite if no path leads to a non reaching state
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (size_t s = 0; s < n; s++) {
+      for (size_t k = markov->row[s]; reach[s] && k < markov->row[s + 1];
+           k++) {
+        if (!reach[markov->col[k]]) {
+          reach[s] = false;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  for (size_t s = 0; s < n; s++) {
+    steps[s] = reach[s] ? 0 : INFINITY;
+  }
+  steps[terminate] = 0;
+
+  // Gauss-Seidel on steps = 1 + P steps, restricted to the reaching states
+  for (size_t it = 1; it <= max_iterations; it++) {
+
+    double delta = 0;
+
+    for (size_t s = 0; s < terminate; s++) {
+      if (!reach[s]) {
+        continue;
+      }
+      double stay = 0;
+      double sum = 1;
+      for (size_t k = markov->row[s]; k < markov->row[s + 1]; k++) {
+        uint32_t t = markov->col[k];
+        if (t == s) {
+          stay = markov->val[k];
+        } else {
+          sum += markov->val[k] * steps[t];
+        }
+      }
+      double value = sum / (1 - stay);
+      double change = fabs(value - steps[s]) / (value > 1 ? value : 1);
+      if (change > delta) {
+        delta = change;
+      }
+      steps[s] = value;
+    }
+
+    if (delta < tolerance) {
+      free(reach);
+      return (int)it;
+    }
+  }
+
+  free(reach);
+
+  return -1;
+}
+
+void fsm_markov_frequencies(const fsm_markov_t *markov,
+                            const double *distribution, double *frequency) {
+
+  size_t words = FSM_EVENT_MASK_WORDS(markov->events);
+
+  for (size_t s = 0; s < markov->states; s++) {
+    for (size_t e = 0; e < markov->events; e++) {
+      const uint32_t *handled = &markov->handled[s * words];
+      frequency[s * markov->events + e] =
+          handled[e / 32] & (UINT32_C(1) << (e % 32))
+              ? distribution[s] * markov->event_probability[e]
+              : 0;
+    }
+  }
+}
@@ -0,0 +1,129 @@
+/**
+ * @file fsm_markov.h
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _FSM_MARKOV_H
+#define _FSM_MARKOV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "fsm.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief
+ * Markov chain of a definition with pure guards, given the probability of
+ * each event to be the next one received. States are numbered by their
+ * position in the state list, `FSM_TERMINATE_STATE` is the extra absorbing
+ * state numbered `states - 1`. An unhandled event leaves the state unchanged.
+ * The transition probability matrix is kept in compressed sparse rows.
+ */
+typedef struct fsm_markov_s {
+  size_t states;             /**< number of states, terminate included */
+  size_t events;             /**< */
+  double *event_probability; /**< normalised copy */
+  uint32_t *handled;         /**< FSM_EVENT_MASK_WORDS(events) words per
+                                state, the events of non zero probability
+                                taking a transition */
+  size_t *row;               /**< row[s] .. row[s + 1] entries of state s */
+  uint32_t *col;             /**< */
+  double *val;               /**< */
+} fsm_markov_t;
+
+/**
+ * @brief Build the transition probability matrix, one sparse row per state
+ * from its transitions. Definitions with deferred events are rejected.
+ *
+ * @param markov the chain
+ * @param state_list
+ * @param event_list
+ * @param event_probability one non negative weight per event, normalised
+ * @return int 0 on success, -1 otherwise
+ */
+int fsm_markov_init(fsm_markov_t *markov, const fsm_state_list_t *state_list,
+                    const fsm_event_list_t *event_list,
+                    const double *event_probability);
+
+/**
+ * @brief
+ *
+ * @param markov the chain
+ */
+void fsm_markov_free(fsm_markov_t *markov);
+
+/**
+ * @brief Long run state occupancy starting from `start`. When the machine can
+ * terminate, all the mass ends in `FSM_TERMINATE_STATE`.
+ *
+ * @param markov the chain
+ * @param start the start state number
+ * @param distribution `states` probabilities
+ * @param tolerance L1 change between two iterations to stop at
+ * @param max_iterations
+ * @return int number of iterations, -1 if not converged
+ */
+int fsm_markov_stationary(const fsm_markov_t *markov, size_t start,
+                          double *distribution, double tolerance,
+                          size_t max_iterations);
+
+/**
+ * @brief Expected number of events before reaching `FSM_TERMINATE_STATE`,
+ * from every state, `INFINITY` for states which cannot terminate
+ *
+ * @param markov the chain
+ * @param steps `states` values
+ * @param tolerance relative change between two iterations to stop at
+ * @param max_iterations
+ * @return int number of iterations, -1 if not converged
+ */
+int fsm_markov_steps(const fsm_markov_t *markov, double *steps,
+                     double tolerance, size_t max_iterations);
+
+/**
+ * @brief Rate of each (state, event) transition per event received:
+ * `frequency[state * events + event] = distribution[state] * p(event)`, 0
+ * when the state does not handle the event
+ *
+ * @param markov the chain
+ * @param distribution `states` probabilities
+ * @param frequency `states * events` rates
+ */
+void fsm_markov_frequencies(const fsm_markov_t *markov,
+                            const double *distribution, double *frequency);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FSM_MARKOV_H */
@@ -0,0 +1,201 @@
+/**
+ * @file fsm_parallel.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_parallel.h"
+#include "fsm_table.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FSM_PARALLEL_MIN_CHUNK (4096) /**< events per thread, at least */
+#define FSM_PARALLEL_CONVERGE (64)    /**< events between convergence checks */
+
+typedef struct fsm_chunk_s {
+  const fsm_table_t *table; /**< */
+  const int *event_ids;     /**< */
+  size_t length;            /**< */
+  uint32_t *map;            /**< end state per start state */
+  uint32_t start;           /**< only lane needed, UINT32_MAX for all */
+  pthread_t thread;         /**< */
+} fsm_chunk_t;
+
+static uint32_t fsm_table_run(const fsm_table_t *table, uint32_t state,
+                              const int *event_ids, size_t length) {
+
+  for (size_t i = 0; i < length; i++) {
+    size_t e = (size_t)event_ids[i];
+    if (e < table->events) {
+      state = table->next[state * table->events + e];
+    }
+  }
+
+  return state;
+}
+
+static void *fsm_chunk_run(void *arg) {
+
+  fsm_chunk_t *chunk = (fsm_chunk_t *)arg;
+  const fsm_table_t *table = chunk->table;
+  size_t lanes = table->states + 1;
+
+  if (chunk->start != UINT32_MAX) {
+    chunk->map[chunk->start] = fsm_table_run(table, chunk->start,
+                                             chunk->event_ids, chunk->length);
+    return NULL;
+  }
+
+  uint32_t *cur = chunk->map;
+  for (size_t s = 0; s < lanes; s++) {
+    cur[s] = (uint32_t)s;
+  }
+
+  size_t i = 0;
+  while (i < chunk->length) {
+
+    size_t end = i + FSM_PARALLEL_CONVERGE;
+    if (end > chunk->length) {
+      end = chunk->length;
+    }
+
+    // advance every lane, the table row of each event stays in cache
+    for (; i < end; i++) {
+      size_t e = (size_t)chunk->event_ids[i];
+      if (e >= table->events) {
+        continue;
+      }
+      for (size_t s = 0; s < lanes; s++) {
+        cur[s] = table->next[cur[s] * table->events + e];
+      }
+    }
+
+    // lanes which met follow the same path: once every lane has converged,
+    // run the rest of the chunk on a single lane
+    bool merged = true;
+    for (size_t s = 1; s < lanes && merged; s++) {
+      merged = cur[s] == cur[0];
+    }
+    if (merged) {
+      uint32_t state = fsm_table_run(table, cur[0], &chunk->event_ids[i],
+                                     chunk->length - i);
+      for (size_t s = 0; s < lanes; s++) {
+        cur[s] = state;
+      }
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+int fsm_recognize(const fsm_state_list_t *state_list,
+                  const fsm_event_list_t *event_list, const fsm_state_t *start,
+                  const int *event_ids, size_t length, size_t threads,
+                  const fsm_state_t **final_state) {
+
+  fsm_table_t table;
+  int res = -1;
+
+  if (start == NULL) {
+    start = &state_list->states[0];
+  }
+
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (size_t)cpus : 1;
+  }
+  if (threads > length / FSM_PARALLEL_MIN_CHUNK) {
+    threads = length / FSM_PARALLEL_MIN_CHUNK;
+  }
+  if (threads == 0) {
+    threads = 1;
+  }
+
+  if (fsm_table_build(&table, state_list, event_list)) {
+    return -1;
+  }
+
+  size_t lanes = table.states + 1;
+  fsm_chunk_t *chunks = (fsm_chunk_t *)calloc(threads, sizeof(fsm_chunk_t));
+  uint32_t *maps = (uint32_t *)malloc(threads * lanes * sizeof(uint32_t));
+  size_t started = 0;
+
+  if (chunks == NULL || maps == NULL) {
+    goto out;
+  }
+
+  for (size_t t = 0; t < threads; t++) {
+    size_t first = length * t / threads;
+    chunks[t].table = &table;
+    chunks[t].event_ids = event_ids + first;
+    chunks[t].length = length * (t + 1) / threads - first;
+    chunks[t].map = &maps[t * lanes];
+    // the first chunk start state is known
+    chunks[t].start = t ? UINT32_MAX : (uint32_t)(start - state_list->states);
+  }
+
+  for (started = 1; started < threads; started++) {
+    if (pthread_create(&chunks[started].thread, NULL, fsm_chunk_run,
+                       &chunks[started])) {
+      break;
+    }
+  }
+
+  fsm_chunk_run(&chunks[0]);
+
+  for (size_t t = 1; t < started; t++) {
+    pthread_join(chunks[t].thread, NULL);
+  }
+
+  if (started < threads) {
+    goto out;
+  }
+
+  uint32_t state = chunks[0].map[chunks[0].start];
+  for (size_t t = 1; t < threads; t++) {
+    state = chunks[t].map[state];
+  }
+
+  *final_state = state == table.states
+                     ? (const fsm_state_t *)&FSM_TERMINATE_STATE
+                     : &state_list->states[state];
+  res = 0;
+
+out:
+  free(chunks);
+  free(maps);
+  fsm_table_free(&table);
+
+  return res;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file fsm_parallel.h
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _FSM_PARALLEL_H
+#define _FSM_PARALLEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "fsm.h"
+
+#include <stddef.h>
+
+/**
+ * @brief
+ * Run an event log through a definition on several threads. The log is split
+ * into one chunk per thread; each chunk computes where every possible start
+ * state ends up and the chunk mappings are then composed to get the exact
+ * final state.
+ *
+ * Guards must be pure: they are evaluated once per (state, event) pair to
+ * build a transition table, and no entry, exit or row action is performed.
+ * `FSM_TERMINATE_STATE` is absorbing. Unknown event ids are ignored.
+ * Definitions with deferred events are rejected.
+ *
+ * @param state_list
+ * @param event_list
+ * @param start the start state, NULL for the first state of the list
+ * @param event_ids the event log
+ * @param length number of events
+ * @param threads number of threads, 0 selects one per online CPU
+ * @param final_state the state reached at the end of the log,
+ * `FSM_TERMINATE_STATE` if it terminated
+ * @return int 0 on success, -1 otherwise
+ */
+int fsm_recognize(const fsm_state_list_t *state_list,
+                  const fsm_event_list_t *event_list, const fsm_state_t *start,
+                  const int *event_ids, size_t length, size_t threads,
+                  const fsm_state_t **final_state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FSM_PARALLEL_H */
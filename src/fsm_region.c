@@ -0,0 +1,400 @@
+/**
+ * @file fsm_region.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_region.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief set the bit of every event a region handles in one of its states
+ *
+ */
+static void fsm_region_handled(const fsm_region_t *region,
+                               const fsm_event_list_t *event_list,
+                               uint32_t *handled) {
+
+  const fsm_state_list_t *state_list = region->state_list;
+
+  for (size_t s = 0; s < state_list->length; s++) {
+
+    const fsm_state_t *state = &state_list->states[s];
+    const fsm_row_list_t *row_list = state->transition.row_list;
+
+    if (state->transition.guard) {
+      for (size_t e = 0; e < event_list->length; e++) {
+        if (fsm_transition_next(state, &event_list->events[e], NULL)) {
+          handled[e / 32] |= UINT32_C(1) << (e % 32);
+        }
+      }
+    } else if (row_list) {
+      for (size_t r = 0; r < row_list->length; r++) {
+        unsigned id = (unsigned)row_list->rows[r].event_id;
+        handled[id / 32] |= UINT32_C(1) << (id % 32);
+      }
+    }
+  }
+}
+
+/**
+ * @brief weight of each region in the product state, false on overflow
+ *
+ */
+static bool fsm_regions_radix(fsm_regions_t *regions) {
+
+  uint64_t weight = 1;
+
+  for (size_t r = 0; r < regions->length; r++) {
+    // terminated is one more state
+    uint64_t base = (uint64_t)regions->regions[r].state_list->length + 1;
+    regions->radix[r] = weight;
+    if (weight > UINT64_MAX / base) {
+      return false;
+    }
+    weight *= base;
+  }
+
+  return true;
+}
+
+int fsm_regions_init(fsm_regions_t *regions, const char *name,
+                     const fsm_region_t *region, size_t length,
+                     const fsm_event_list_t *event_list, size_t cache_size) {
+
+  size_t events = event_list->length;
+  size_t words = FSM_EVENT_MASK_WORDS(events);
+
+  memset(regions, 0, sizeof(fsm_regions_t));
+
+  if (length == 0 || length > FSM_REGION_MAX) {
+    return -1;
+  }
+
+  for (size_t r = 0; r < length; r++) {
+    if (fsm_state_list_defers(region[r].state_list)) {
+      return -1;
+    }
+  }
+
+  regions->name = name;
+  regions->length = length;
+  regions->regions = region;
+  regions->event_list = event_list;
+  regions->state = (size_t *)malloc(length * sizeof(size_t));
+  regions->handler = (size_t *)calloc(events + 1, sizeof(size_t));
+  regions->handlers = (size_t *)malloc(length * events * sizeof(size_t) + 1);
+  regions->radix = (uint64_t *)malloc(length * sizeof(uint64_t));
+
+  uint32_t *handled = (uint32_t *)calloc(length * words + 1, sizeof(uint32_t));
+
+  if (regions->state == NULL || regions->handler == NULL ||
+      regions->handlers == NULL || regions->radix == NULL || handled == NULL) {
+    free(handled);
+    fsm_regions_free(regions);
+    return -1;
+  }
+
+  for (size_t r = 0; r < length; r++) {
+    fsm_row_list_index(region[r].state_list, event_list);
+    fsm_region_handled(&region[r], event_list, &handled[r * words]);
+    regions->state[r] = SIZE_MAX;
+  }
+
+  // regions of each event, in region order
+  size_t count = 0;
+  for (size_t e = 0; e < events; e++) {
+    regions->handler[e] = count;
+    for (size_t r = 0; r < length; r++) {
+      if (handled[r * words + e / 32] & (UINT32_C(1) << (e % 32))) {
+        regions->handlers[count++] = r;
+      }
+    }
+  }
+  regions->handler[events] = count;
+
+  free(handled);
+
+  if (cache_size && !fsm_regions_radix(regions)) {
+    fprintf(stderr,
+            "warning: fsm `%s`, product state too large, cache disabled\r\n",
+            name);
+    cache_size = 0;
+  }
+
+  if (cache_size) {
+    size_t size = 1;
+    while (size < cache_size) {
+      size <<= 1;
+    }
+    regions->cache =
+        (fsm_region_cache_t *)malloc(size * sizeof(fsm_region_cache_t));
+    regions->cache_row =
+        (const fsm_row_t **)calloc(size * length, sizeof(const fsm_row_t *));
+    if (regions->cache == NULL || regions->cache_row == NULL) {
+      fsm_regions_free(regions);
+      return -1;
+    }
+    for (size_t i = 0; i < size; i++) {
+      regions->cache[i].event_id = -1;
+    }
+    regions->cache_size = size;
+  }
+
+  return 0;
+}
+
+void fsm_regions_free(fsm_regions_t *regions) {
+
+  free(regions->state);
+  free(regions->handler);
+  free(regions->handlers);
+  free(regions->radix);
+  free(regions->cache);
+  free((void *)regions->cache_row);
+
+  regions->state = NULL;
+  regions->handler = NULL;
+  regions->handlers = NULL;
+  regions->radix = NULL;
+  regions->cache = NULL;
+  regions->cache_row = NULL;
+  regions->cache_size = 0;
+}
+
+/**
+ * @brief enter the initial state of every region on first use
+ *
+ */
+static void fsm_regions_start(fsm_regions_t *regions) {
+
+  if (regions->state[0] != SIZE_MAX) {
+    return;
+  }
+
+  regions->product = 0;
+  regions->active = regions->length;
+
+  for (size_t r = 0; r < regions->length; r++) {
+    const fsm_region_t *region = &regions->regions[r];
+    const fsm_state_t *state = region->init_state
+                                   ? region->init_state
+                                   : &region->state_list->states[0];
+    regions->state[r] = (size_t)(state - region->state_list->states);
+    if (regions->cache_size) {
+      regions->product += regions->state[r] * regions->radix[r];
+    }
+    if (state->on_entry) {
+      state->on_entry();
+    }
+  }
+}
+
+/**
+ * @brief perform the transition of region `r` to `next`
+ *
+ */
+static void fsm_regions_fire(fsm_regions_t *regions, size_t r,
+                             const fsm_event_t *event, const fsm_row_t *row,
+                             size_t next) {
+
+  const fsm_state_list_t *state_list = regions->regions[r].state_list;
+  const fsm_state_t *state = &state_list->states[regions->state[r]];
+
+  if (state->on_exit) {
+    state->on_exit();
+  }
+
+  if (row && row->action) {
+    row->action(event);
+  }
+
+  regions->state[r] = next;
+
+  if (next == state_list->length) {
+    regions->active--;
+    return;
+  }
+
+  if (state_list->states[next].on_entry) {
+    state_list->states[next].on_entry();
+  }
+}
+
+/**
+ * @brief evaluate the regions handling `event`
+ *
+ * @return uint32_t the regions which took a transition
+ */
+static uint32_t fsm_regions_eval(fsm_regions_t *regions,
+                                 const fsm_event_t *event,
+                                 const fsm_row_t **rows) {
+
+  uint32_t fired = 0;
+  size_t end = regions->handler[event->id + 1];
+
+  for (size_t h = regions->handler[event->id]; h < end; h++) {
+
+    size_t r = regions->handlers[h];
+    const fsm_state_list_t *state_list = regions->regions[r].state_list;
+
+    if (regions->state[r] == state_list->length) {
+      continue;
+    }
+
+    const fsm_row_t *row = NULL;
+    const fsm_state_t *nxt_state = fsm_transition_next(
+        &state_list->states[regions->state[r]], event, &row);
+
+    if (nxt_state == NULL) {
+      continue;
+    }
+
+    size_t next = nxt_state == (const fsm_state_t *)&FSM_TERMINATE_STATE
+                      ? state_list->length
+                      : (size_t)(nxt_state - state_list->states);
+
+    fired |= UINT32_C(1) << r;
+    if (rows) {
+      rows[r] = row;
+    }
+
+    fsm_regions_fire(regions, r, event, row, next);
+  }
+
+  return fired;
+}
+
+/**
+ * @brief replay a cached product transition
+ *
+ */
+static void fsm_regions_replay(fsm_regions_t *regions,
+                               const fsm_event_t *event,
+                               const fsm_region_cache_t *entry,
+                               const fsm_row_t **rows) {
+
+  for (uint32_t fired = entry->fired; fired; fired &= fired - 1) {
+    size_t r = (size_t)__builtin_ctz(fired);
+    size_t base = regions->regions[r].state_list->length + 1;
+    size_t next = (size_t)((entry->next / regions->radix[r]) % base);
+    fsm_regions_fire(regions, r, event, rows[r], next);
+  }
+
+  regions->product = entry->next;
+}
+
+/**
+ * @brief process one event
+ *
+ * @return true if every region is terminated
+ */
+static bool fsm_regions_step(fsm_regions_t *regions, int event_id) {
+
+  if ((size_t)event_id >= regions->event_list->length) {
+    fprintf(stderr, "warning: fsm `%s`, unknown event id %d\r\n",
+            regions->name, event_id);
+    return false;
+  }
+
+  const fsm_event_t *event = &regions->event_list->events[event_id];
+
+  if (regions->cache_size == 0) {
+    fsm_regions_eval(regions, event, NULL);
+    return regions->active == 0;
+  }
+
+  uint64_t key = regions->product * regions->event_list->length +
+                 (uint64_t)event_id;
+  key ^= key >> 33;
+  key *= UINT64_C(0xff51afd7ed558ccd);
+  key ^= key >> 33;
+
+  size_t slot = (size_t)key & (regions->cache_size - 1);
+  fsm_region_cache_t *entry = &regions->cache[slot];
+  const fsm_row_t **rows = &regions->cache_row[slot * regions->length];
+
+  if (entry->event_id == event_id && entry->product == regions->product) {
+    regions->hits++;
+    fsm_regions_replay(regions, event, entry, rows);
+    return regions->active == 0;
+  }
+
+  // evaluate, then replace whatever the slot held
+  regions->misses++;
+  entry->product = regions->product;
+  entry->event_id = event_id;
+  entry->fired = fsm_regions_eval(regions, event, rows);
+
+  for (uint32_t fired = entry->fired; fired; fired &= fired - 1) {
+    size_t r = (size_t)__builtin_ctz(fired);
+    size_t base = regions->regions[r].state_list->length + 1;
+    uint64_t prev = entry->product / regions->radix[r] % base;
+    // modular arithmetic, the result is the new product state
+    regions->product += (regions->state[r] - prev) * regions->radix[r];
+  }
+  entry->next = regions->product;
+
+  return regions->active == 0;
+}
+
+size_t fsm_regions_dispatch(fsm_regions_t *regions, const int *event_ids,
+                            size_t length) {
+
+  fsm_regions_start(regions);
+
+  for (size_t i = 0; i < length; i++) {
+    if (regions->active == 0) {
+      return i;
+    }
+    if (fsm_regions_step(regions, event_ids[i])) {
+      return i + 1;
+    }
+  }
+
+  return length;
+}
+
+const fsm_state_t *fsm_regions_state(const fsm_regions_t *regions,
+                                     size_t region) {
+
+  const fsm_state_list_t *state_list = regions->regions[region].state_list;
+  size_t state = regions->state[region];
+
+  if (state == SIZE_MAX) {
+    return NULL;
+  }
+
+  if (state == state_list->length) {
+    return (const fsm_state_t *)&FSM_TERMINATE_STATE;
+  }
+
+  return &state_list->states[state];
+}
@@ -0,0 +1,155 @@
+/**
+ * @file fsm_region.h
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _FSM_REGION_H
+#define _FSM_REGION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "fsm.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FSM_REGION_MAX (32) /**< regions of a composite machine */
+
+/**
+ * @brief
+ * Orthogonal region, a flat machine active together with the other regions
+ * of a composite machine and sharing its event list.
+ */
+typedef struct fsm_region_s {
+  const char *name;                   /**< */
+  const fsm_state_list_t *state_list; /**< */
+  const fsm_state_t *init_state;      /**< NULL for the first state */
+} fsm_region_t;
+
+/**
+ * @brief
+ * Product transition cached for a (product state, event) pair
+ */
+typedef struct fsm_region_cache_s {
+  uint64_t product; /**< */
+  uint64_t next;    /**< product state reached */
+  int event_id;     /**< -1 if the entry is empty */
+  uint32_t fired;   /**< regions which took a transition */
+} fsm_region_cache_t;
+
+/**
+ * @brief
+ * Composite machine made of orthogonal regions. Every event is received
+ * once and only evaluated by the regions handling it in one of their states.
+ * A product state numbers the states of all regions in mixed radix, the
+ * transitions between product states are optionally cached as they are
+ * encountered.
+ */
+typedef struct fsm_regions_s {
+  const char *name;                   /**< */
+  size_t length;                      /**< number of regions */
+  const fsm_region_t *regions;        /**< */
+  const fsm_event_list_t *event_list; /**< */
+  size_t *state;    /**< state index of each region, its state list length
+                       once terminated, SIZE_MAX before the start */
+  size_t active;    /**< regions not terminated */
+  size_t *handlers; /**< handlers[h[e]] .. handlers[h[e + 1]] regions handling
+                       event e, `handler` holds h */
+  size_t *handler;  /**< */
+  uint64_t *radix;  /**< product state weight of each region */
+  uint64_t product; /**< */
+  size_t cache_size;           /**< power of two, 0 when disabled */
+  fsm_region_cache_t *cache;   /**< */
+  const fsm_row_t **cache_row; /**< rows of each entry, `length` per entry */
+  size_t hits;                 /**< */
+  size_t misses;               /**< */
+} fsm_regions_t;
+
+/**
+ * @brief Initialise a composite machine. The events handled by a region are
+ * the events of its rows and the events its guard functions return a state
+ * for, guard functions are probed once per (state, event) pair. Regions keep
+ * no deferred events queue, regions with deferred events are rejected.
+ *
+ * With a cache, the transition of a product state upon an event is evaluated
+ * once and replayed afterwards: the exit, row and entry actions are still
+ * performed but the guards are not, they must only depend on the event.
+ *
+ * @param regions the composite machine
+ * @param name
+ * @param region the regions, at most FSM_REGION_MAX
+ * @param length number of regions
+ * @param event_list events shared by the regions
+ * @param cache_size number of cached product transitions, rounded up to a
+ * power of two, 0 disables the cache
+ * @return int 0 on success, -1 otherwise
+ */
+int fsm_regions_init(fsm_regions_t *regions, const char *name,
+                     const fsm_region_t *region, size_t length,
+                     const fsm_event_list_t *event_list, size_t cache_size);
+
+/**
+ * @brief
+ *
+ * @param regions the composite machine
+ */
+void fsm_regions_free(fsm_regions_t *regions);
+
+/**
+ * @brief Process a batch of events, the regions enter their initial state on
+ * first use. Within an event, regions take their transitions in order, each
+ * one performing its exit, row and entry actions.
+ *
+ * @param regions the composite machine
+ * @param event_ids the events ids
+ * @param length number of events
+ * @return size_t number of events consumed, less than `length` if every
+ * region terminated
+ */
+size_t fsm_regions_dispatch(fsm_regions_t *regions, const int *event_ids,
+                            size_t length);
+
+/**
+ * @brief Current state of a region
+ *
+ * @param regions the composite machine
+ * @param region the region number
+ * @return const fsm_state_t* the state, `FSM_TERMINATE_STATE` if terminated,
+ * NULL before the start
+ */
+const fsm_state_t *fsm_regions_state(const fsm_regions_t *regions,
+                                     size_t region);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FSM_REGION_H */
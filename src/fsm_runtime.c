@@ -0,0 +1,484 @@
+/**
+ * @file fsm_runtime.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* pthread_setaffinity_np */
+#endif
+
+#include "fsm_runtime.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FSM_CACHE_LINE (64)
+
+typedef struct fsm_rt_msg_s {
+  int instance_id; /**< */
+  int event_id;    /**< */
+} fsm_rt_msg_t;
+
+/**
+ * @brief
+ * Unit of transfer between shards. Inboxes are Treiber stacks of batches: a
+ * producer publishes a whole batch with a single CAS and the consumer takes
+ * the whole stack with a single exchange.
+ */
+typedef struct fsm_rt_batch_s {
+  struct fsm_rt_batch_s *next;               /**< */
+  size_t length;                             /**< */
+  fsm_rt_msg_t msgs[FSM_RUNTIME_BATCH_SIZE]; /**< */
+} fsm_rt_batch_t;
+
+typedef struct fsm_shard_s {
+  _Alignas(FSM_CACHE_LINE) _Atomic(fsm_rt_batch_t *) inbox; /**< */
+  atomic_bool sleeping;                                     /**< */
+  _Alignas(FSM_CACHE_LINE) size_t index;                    /**< */
+  int cpu;                                                  /**< */
+  fsm_runtime_t *runtime;                                   /**< */
+  fsm_rt_batch_t **outbox; /**< pending batch per destination shard */
+  pthread_t thread;        /**< */
+  pthread_mutex_t mutex;   /**< only taken to park an idle worker */
+  pthread_cond_t cond;     /**< */
+} fsm_shard_t;
+
+struct fsm_runtime_s {
+  size_t shard_count;    /**< */
+  fsm_shard_t *shards;   /**< */
+  size_t capacity;       /**< */
+  size_t length;         /**< */
+  fsm_t **instances;     /**< */
+  atomic_bool running;   /**< */
+  atomic_size_t pending; /**< messages published, not yet dispatched */
+  bool started;          /**< */
+};
+
+static _Thread_local fsm_shard_t *fsm_cur_shard = NULL;
+static _Thread_local int fsm_cur_instance = -1;
+
+static fsm_rt_batch_t *fsm_rt_batch_new(void) {
+  fsm_rt_batch_t *batch = (fsm_rt_batch_t *)malloc(sizeof(fsm_rt_batch_t));
+  if (batch) {
+    batch->next = NULL;
+    batch->length = 0;
+  }
+  return batch;
+}
+
+static void fsm_rt_batch_free_all(fsm_rt_batch_t *batch) {
+  while (batch) {
+    fsm_rt_batch_t *next = batch->next;
+    free(batch);
+    batch = next;
+  }
+}
+
+static void fsm_shard_push(fsm_shard_t *shard, fsm_rt_batch_t *batch) {
+
+  // counted before it is visible, so that stop never misses it
+  atomic_fetch_add(&shard->runtime->pending, batch->length);
+
+  fsm_rt_batch_t *head = atomic_load_explicit(&shard->inbox,
+                                              memory_order_relaxed);
+  do {
+    batch->next = head;
+  } while (!atomic_compare_exchange_weak(&shard->inbox, &head, batch));
+
+  if (atomic_load(&shard->sleeping)) {
+    pthread_mutex_lock(&shard->mutex);
+    pthread_cond_signal(&shard->cond);
+    pthread_mutex_unlock(&shard->mutex);
+  }
+}
+
+/**
+ * @brief take every published batch, in publication order
+ */
+static fsm_rt_batch_t *fsm_shard_take(fsm_shard_t *shard) {
+
+  fsm_rt_batch_t *batch = atomic_exchange(&shard->inbox, NULL);
+  fsm_rt_batch_t *fifo = NULL;
+
+  while (batch) {
+    fsm_rt_batch_t *next = batch->next;
+    batch->next = fifo;
+    fifo = batch;
+    batch = next;
+  }
+
+  return fifo;
+}
+
+static void fsm_shard_wait(fsm_shard_t *shard) {
+
+  struct timespec ts;
+
+  pthread_mutex_lock(&shard->mutex);
+  atomic_store(&shard->sleeping, true);
+
+  if (atomic_load(&shard->inbox) == NULL &&
+      (atomic_load(&shard->runtime->running) ||
+       atomic_load(&shard->runtime->pending))) {
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(&shard->cond, &shard->mutex, &ts);
+  }
+
+  atomic_store(&shard->sleeping, false);
+  pthread_mutex_unlock(&shard->mutex);
+}
+
+static void fsm_shard_flush(fsm_shard_t *shard) {
+
+  fsm_runtime_t *rt = shard->runtime;
+
+  for (size_t i = 0; i < rt->shard_count; i++) {
+    if (shard->outbox[i]) {
+      fsm_shard_push(&rt->shards[i], shard->outbox[i]);
+      shard->outbox[i] = NULL;
+    }
+  }
+}
+
+static void fsm_shard_dispatch(fsm_shard_t *shard, const fsm_rt_msg_t *msg) {
+
+  fsm_t *fsm = shard->runtime->instances[msg->instance_id];
+
+  fsm_cur_instance = msg->instance_id;
+
+  fsm_dispatch(fsm, &msg->event_id, 1);
+
+  fsm_cur_instance = -1;
+}
+
+static void fsm_shard_pin(fsm_shard_t *shard) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(shard->cpu, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+    fprintf(stderr, "warning: shard %zu, failed to pin to cpu %d\r\n",
+            shard->index, shard->cpu);
+  }
+#else
+  (void)shard;
+#endif
+}
+
+static void *fsm_shard_run(void *arg) {
+
+  fsm_shard_t *shard = (fsm_shard_t *)arg;
+
+  fsm_shard_pin(shard);
+
+  fsm_cur_shard = shard;
+
+  for (;;) {
+    fsm_rt_batch_t *batch = fsm_shard_take(shard);
+    size_t dispatched = 0;
+
+    if (batch == NULL) {
+      // another shard may still send to this one until nothing is in flight
+      if (!atomic_load(&shard->runtime->running) &&
+          atomic_load(&shard->runtime->pending) == 0) {
+        break;
+      }
+      fsm_shard_wait(shard);
+      continue;
+    }
+
+    while (batch) {
+      fsm_rt_batch_t *next = batch->next;
+      for (size_t i = 0; i < batch->length; i++) {
+        fsm_shard_dispatch(shard, &batch->msgs[i]);
+      }
+      dispatched += batch->length;
+      free(batch);
+      batch = next;
+    }
+
+    // end of tick, publish what the actions sent before retiring the tick
+    fsm_shard_flush(shard);
+    atomic_fetch_sub(&shard->runtime->pending, dispatched);
+  }
+
+  fsm_cur_shard = NULL;
+
+  return NULL;
+}
+
+fsm_runtime_t *fsm_runtime_create(size_t shard_count, size_t capacity) {
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus < 1) {
+    cpus = 1;
+  }
+
+  if (shard_count == 0) {
+    shard_count = (size_t)cpus;
+  }
+
+  fsm_runtime_t *rt = (fsm_runtime_t *)calloc(1, sizeof(fsm_runtime_t));
+  if (rt == NULL) {
+    return NULL;
+  }
+
+  size_t size = shard_count * sizeof(fsm_shard_t);
+  size = (size + FSM_CACHE_LINE - 1) & ~(size_t)(FSM_CACHE_LINE - 1);
+
+  rt->shards = (fsm_shard_t *)aligned_alloc(FSM_CACHE_LINE, size);
+  rt->instances = (fsm_t **)calloc(capacity ? capacity : 1, sizeof(fsm_t *));
+
+  if (rt->shards == NULL || rt->instances == NULL) {
+    free(rt->shards);
+    free(rt->instances);
+    free(rt);
+    return NULL;
+  }
+
+  memset(rt->shards, 0, size);
+  rt->shard_count = shard_count;
+  rt->capacity = capacity;
+  rt->length = 0;
+  atomic_init(&rt->running, false);
+  atomic_init(&rt->pending, 0);
+  rt->started = false;
+
+  for (size_t i = 0; i < shard_count; i++) {
+    fsm_shard_t *shard = &rt->shards[i];
+    atomic_init(&shard->inbox, NULL);
+    atomic_init(&shard->sleeping, false);
+    shard->index = i;
+    shard->cpu = (int)(i % (size_t)cpus);
+    shard->runtime = rt;
+    shard->outbox =
+        (fsm_rt_batch_t **)calloc(shard_count, sizeof(fsm_rt_batch_t *));
+    assert(shard->outbox != NULL);
+    pthread_mutex_init(&shard->mutex, NULL);
+    pthread_cond_init(&shard->cond, NULL);
+  }
+
+  return rt;
+}
+
+void fsm_runtime_destroy(fsm_runtime_t *rt) {
+
+  if (rt == NULL) {
+    return;
+  }
+
+  fsm_runtime_stop(rt);
+
+  for (size_t i = 0; i < rt->shard_count; i++) {
+    fsm_shard_t *shard = &rt->shards[i];
+    fsm_rt_batch_free_all(fsm_shard_take(shard));
+    for (size_t j = 0; j < rt->shard_count; j++) {
+      free(shard->outbox[j]);
+    }
+    free(shard->outbox);
+    pthread_mutex_destroy(&shard->mutex);
+    pthread_cond_destroy(&shard->cond);
+  }
+
+  free(rt->shards);
+  free(rt->instances);
+  free(rt);
+}
+
+int fsm_runtime_add(fsm_runtime_t *rt, fsm_t *fsm) {
+
+  if (rt->started || rt->length >= rt->capacity) {
+    return -1;
+  }
+
+  rt->instances[rt->length] = fsm;
+
+  return (int)rt->length++;
+}
+
+int fsm_runtime_start(fsm_runtime_t *rt) {
+
+  if (rt->started) {
+    return -1;
+  }
+
+  atomic_store(&rt->running, true);
+  rt->started = true;
+
+  for (size_t i = 0; i < rt->shard_count; i++) {
+    fsm_shard_t *shard = &rt->shards[i];
+    if (pthread_create(&shard->thread, NULL, fsm_shard_run, shard)) {
+      fprintf(stderr, "error: shard %zu, failed to start\r\n", i);
+      atomic_store(&rt->running, false);
+      for (size_t j = 0; j < i; j++) {
+        pthread_join(rt->shards[j].thread, NULL);
+      }
+      rt->started = false;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+void fsm_runtime_stop(fsm_runtime_t *rt) {
+
+  if (!rt->started) {
+    return;
+  }
+
+  atomic_store(&rt->running, false);
+
+  for (size_t i = 0; i < rt->shard_count; i++) {
+    fsm_shard_t *shard = &rt->shards[i];
+    pthread_mutex_lock(&shard->mutex);
+    pthread_cond_signal(&shard->cond);
+    pthread_mutex_unlock(&shard->mutex);
+  }
+
+  for (size_t i = 0; i < rt->shard_count; i++) {
+    pthread_join(rt->shards[i].thread, NULL);
+  }
+
+  rt->started = false;
+}
+
+static bool fsm_runtime_valid(const fsm_runtime_t *rt, int instance_id,
+                              int event_id) {
+  return instance_id >= 0 && (size_t)instance_id < rt->length &&
+         event_id >= 0 &&
+         (size_t)event_id < rt->instances[instance_id]->event_list->length;
+}
+
+int fsm_runtime_send(fsm_runtime_t *rt, int instance_id, int event_id) {
+
+  if (!fsm_runtime_valid(rt, instance_id, event_id)) {
+    return -1;
+  }
+
+  fsm_shard_t *dst = &rt->shards[(size_t)instance_id % rt->shard_count];
+  fsm_shard_t *src = fsm_cur_shard;
+  fsm_rt_batch_t *batch;
+
+  if (src != NULL && src->runtime == rt) {
+    fsm_rt_batch_t **outbox = &src->outbox[dst->index];
+    if (*outbox == NULL && (*outbox = fsm_rt_batch_new()) == NULL) {
+      return -1;
+    }
+    batch = *outbox;
+    batch->msgs[batch->length].instance_id = instance_id;
+    batch->msgs[batch->length].event_id = event_id;
+    if (++batch->length == FSM_RUNTIME_BATCH_SIZE) {
+      fsm_shard_push(dst, batch);
+      *outbox = NULL;
+    }
+    return 0;
+  }
+
+  if ((batch = fsm_rt_batch_new()) == NULL) {
+    return -1;
+  }
+
+  batch->msgs[0].instance_id = instance_id;
+  batch->msgs[0].event_id = event_id;
+  batch->length = 1;
+
+  fsm_shard_push(dst, batch);
+
+  return 0;
+}
+
+int fsm_runtime_send_n(fsm_runtime_t *rt, const int *instance_ids,
+                       const int *event_ids, size_t length) {
+
+  for (size_t i = 0; i < length; i++) {
+    if (!fsm_runtime_valid(rt, instance_ids[i], event_ids[i])) {
+      return -1;
+    }
+  }
+
+  // a worker already batches per destination in its outbox
+  if (fsm_cur_shard != NULL && fsm_cur_shard->runtime == rt) {
+    for (size_t i = 0; i < length; i++) {
+      if (fsm_runtime_send(rt, instance_ids[i], event_ids[i])) {
+        return -1;
+      }
+    }
+    return 0;
+  }
+
+  // batch under construction per destination shard
+  fsm_rt_batch_t **open =
+      (fsm_rt_batch_t **)calloc(rt->shard_count, sizeof(fsm_rt_batch_t *));
+  int res = open ? 0 : -1;
+
+  for (size_t i = 0; i < length && res == 0; i++) {
+    size_t d = (size_t)instance_ids[i] % rt->shard_count;
+    if (open[d] == NULL && (open[d] = fsm_rt_batch_new()) == NULL) {
+      res = -1;
+      break;
+    }
+    fsm_rt_batch_t *batch = open[d];
+    batch->msgs[batch->length].instance_id = instance_ids[i];
+    batch->msgs[batch->length].event_id = event_ids[i];
+    if (++batch->length == FSM_RUNTIME_BATCH_SIZE) {
+      fsm_shard_push(&rt->shards[d], batch);
+      open[d] = NULL;
+    }
+  }
+
+  for (size_t d = 0; open && d < rt->shard_count; d++) {
+    if (open[d]) {
+      fsm_shard_push(&rt->shards[d], open[d]);
+    }
+  }
+
+  free(open);
+
+  return res;
+}
+
+int fsm_runtime_self(void) { return fsm_cur_instance; }
+
+int fsm_runtime_shard_of(const fsm_runtime_t *rt, int instance_id) {
+  return (int)((size_t)instance_id % rt->shard_count);
+}
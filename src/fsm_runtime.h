@@ -0,0 +1,154 @@
+/**
+ * @file fsm_runtime.h
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _FSM_RUNTIME_H
+#define _FSM_RUNTIME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "fsm.h"
+
+#include <stddef.h>
+
+#ifndef FSM_RUNTIME_BATCH_SIZE
+#define FSM_RUNTIME_BATCH_SIZE (64) /**< messages per cross-shard batch */
+#endif
+
+/**
+ * @brief
+ * Sharded runtime hosting many finite state machine instances. Every instance
+ * is owned by exactly one shard; a shard is a worker thread pinned to a CPU
+ * core with its own lock-free multi-producer/single-consumer inbox.
+ */
+typedef struct fsm_runtime_s fsm_runtime_t;
+
+/**
+ * @brief Create a runtime
+ *
+ * @param shard_count number of shards (worker threads), 0 selects one shard
+ * per online CPU
+ * @param capacity maximum number of instances
+ * @return fsm_runtime_t* Upon successful completion the runtime is returned.
+ * Otherwise, NULL is returned
+ */
+fsm_runtime_t *fsm_runtime_create(size_t shard_count, size_t capacity);
+
+/**
+ * @brief Stop the runtime if still running and release it
+ *
+ * @param rt the runtime
+ */
+void fsm_runtime_destroy(fsm_runtime_t *rt);
+
+/**
+ * @brief Register an initialised finite state machine. Instances can only be
+ * added before the runtime is started.
+ *
+ * @param rt the runtime
+ * @param fsm the finite state machine struct, owned by the caller
+ * @return int Upon successful completion the instance id is returned.
+ * Otherwise, -1 is returned
+ */
+int fsm_runtime_add(fsm_runtime_t *rt, fsm_t *fsm);
+
+/**
+ * @brief Start one worker thread per shard
+ *
+ * @param rt the runtime
+ * @return int 0 on success, -1 otherwise
+ */
+int fsm_runtime_start(fsm_runtime_t *rt);
+
+/**
+ * @brief Deliver the messages already sent, including the messages the state
+ * actions send meanwhile, then join the worker threads. Returns once no
+ * message is in flight, an endless exchange of messages never stops.
+ *
+ * @param rt the runtime
+ */
+void fsm_runtime_stop(fsm_runtime_t *rt);
+
+/**
+ * @brief Route an event to an instance. When called from a shard worker (i.e.
+ * from a state action) the message is buffered and delivered with the other
+ * messages for the same destination shard at the end of the current tick.
+ *
+ * From any other thread the message is published on its own: a batch is
+ * allocated, pushed with a CAS and freed by the worker, for every message.
+ * External producers sending many messages use `fsm_runtime_send_n`.
+ *
+ * @param rt the runtime
+ * @param instance_id the destination instance
+ * @param event_id the event id in the destination instance event list
+ * @return int 0 on success, -1 otherwise
+ */
+int fsm_runtime_send(fsm_runtime_t *rt, int instance_id, int event_id);
+
+/**
+ * @brief Route a burst of events, `event_ids[i]` to `instance_ids[i]`. The
+ * messages are grouped per destination shard in batches of
+ * FSM_RUNTIME_BATCH_SIZE, each batch published with a single CAS. The order
+ * of the messages to the same instance is kept.
+ *
+ * @param rt the runtime
+ * @param instance_ids the destination instances
+ * @param event_ids the event ids in the destination instances event lists
+ * @param length number of messages
+ * @return int 0 on success, -1 if a message is invalid, then none is sent, or
+ * upon allocation failure, then only part of them may be sent
+ */
+int fsm_runtime_send_n(fsm_runtime_t *rt, const int *instance_ids,
+                       const int *event_ids, size_t length);
+
+/**
+ * @brief
+ *
+ * @return int the id of the instance being dispatched by the calling worker,
+ * -1 when called outside of a state action
+ */
+int fsm_runtime_self(void);
+
+/**
+ * @brief
+ *
+ * @param rt the runtime
+ * @param instance_id the instance
+ * @return int the shard owning the instance
+ */
+int fsm_runtime_shard_of(const fsm_runtime_t *rt, int instance_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FSM_RUNTIME_H */
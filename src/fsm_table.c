@@ -0,0 +1,81 @@
+/**
+ * @file fsm_table.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_table.h"
+
+#include <stdlib.h>
+
+int fsm_table_build(fsm_table_t *table, const fsm_state_list_t *state_list,
+                    const fsm_event_list_t *event_list) {
+
+  size_t terminate = state_list->length;
+
+  if (fsm_state_list_defers(state_list)) {
+    return -1;
+  }
+
+  table->states = state_list->length;
+  table->events = event_list->length;
+  table->next = (uint32_t *)calloc((table->states + 1) * table->events + 1,
+                                   sizeof(uint32_t));
+  if (table->next == NULL) {
+    return -1;
+  }
+
+  for (size_t s = 0; s < table->states; s++) {
+    for (size_t e = 0; e < table->events; e++) {
+      const fsm_state_t *nxt = fsm_transition_next(
+          &state_list->states[s], &event_list->events[e], NULL);
+      size_t n = s;
+      if (nxt == (const fsm_state_t *)&FSM_TERMINATE_STATE) {
+        n = terminate;
+      } else if (nxt) {
+        n = (size_t)(nxt - state_list->states);
+        if (n >= table->states) {
+          fsm_table_free(table);
+          return -1;
+        }
+      }
+      table->next[s * table->events + e] = (uint32_t)n;
+    }
+  }
+
+  for (size_t e = 0; e < table->events; e++) {
+    table->next[terminate * table->events + e] = (uint32_t)terminate;
+  }
+
+  return 0;
+}
+
+void fsm_table_free(fsm_table_t *table) {
+  free(table->next);
+  table->next = NULL;
+}
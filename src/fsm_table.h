@@ -0,0 +1,80 @@
+/**
+ * @file fsm_table.h
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef _FSM_TABLE_H
+#define _FSM_TABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "fsm.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief
+ * Dense transition table of a definition with pure guards. States are
+ * numbered by their position in the state list, `FSM_TERMINATE_STATE` is the
+ * extra absorbing state numbered `states`. An unhandled event leaves the state
+ * unchanged.
+ */
+typedef struct fsm_table_s {
+  size_t states;  /**< number of states, terminate excluded */
+  size_t events;  /**< */
+  uint32_t *next; /**< next[state * events + event] */
+} fsm_table_t;
+
+/**
+ * @brief Tabulate a definition, the guards are evaluated once per (state,
+ * event) pair. A definition with deferred events is rejected.
+ *
+ * @param table the table
+ * @param state_list
+ * @param event_list
+ * @return int 0 on success, -1 otherwise
+ */
+int fsm_table_build(fsm_table_t *table, const fsm_state_list_t *state_list,
+                    const fsm_event_list_t *event_list);
+
+/**
+ * @brief
+ *
+ * @param table the table
+ */
+void fsm_table_free(fsm_table_t *table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FSM_TABLE_H */
@@ -0,0 +1,118 @@
+/**
+ * @file TEST_coro.cc
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_coro.hpp"
+#include "../example/fsm_ex.h"
+
+#include <cassert>
+#include <coroutine>
+#include <deque>
+
+namespace {
+
+const fsm_state_t *const terminate_state =
+    reinterpret_cast<const fsm_state_t *>(&FSM_TERMINATE_STATE);
+
+std::deque<const fsm_state_t *> entered;
+
+/**
+ * @brief executor resuming one scheduled coroutine per `run_one`
+ */
+struct TEST_executor {
+  struct awaiter {
+    TEST_executor *executor;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      executor->queue.push_back(handle);
+    }
+    void await_resume() const noexcept {}
+  };
+
+  awaiter schedule() { return {this}; }
+
+  bool run_one() {
+    if (queue.empty()) {
+      return false;
+    }
+    std::coroutine_handle<> handle = queue.front();
+    queue.pop_front();
+    handle.resume();
+    return true;
+  }
+
+  std::deque<std::coroutine_handle<>> queue;
+};
+
+fsm::task TEST_coro_waiter(fsm::machine machine) {
+
+  // the initial state is entered by the first step
+  entered.push_back(co_await machine.enter(&ex_state_list.states[0]));
+  entered.push_back(co_await machine.enter(&ex_state_list.states[2]));
+  entered.push_back(co_await machine.next_transition());
+  entered.push_back(co_await machine.next_transition());
+}
+
+} // namespace
+
+int main() {
+
+  fsm_t fsm;
+  TEST_executor executor;
+
+  fsm_init(&fsm, "coro", &ex_state_list, NULL, &ex_event_list);
+
+  fsm::machine machine(&fsm);
+
+  TEST_coro_waiter(machine);
+  assert(entered.empty());
+
+  fsm::drive(machine, executor);
+
+  // State_0 -> State_1 -> State_2 -> State_3 -> terminate
+  const int events[] = {1, 2, 3, 2};
+
+  for (int id : events) {
+    assert(!machine.terminated());
+    machine.put(&ex_event_list.events[id]);
+    assert(executor.run_one());
+  }
+
+  assert(machine.terminated());
+  assert(!executor.run_one());
+
+  assert(entered.size() == 4);
+  assert(entered[0] == &ex_state_list.states[0]);
+  assert(entered[1] == &ex_state_list.states[2]);
+  assert(entered[2] == &ex_state_list.states[3]);
+  assert(entered[3] == terminate_state);
+
+  return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file TEST_explore.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_explore.h"
+#include "../example/fsm_ex.h"
+
+#include <assert.h>
+#include <string.h>
+
+static const fsm_event_t lock_events[] = {
+    {.id = 0, .name = "Event_1"},
+    {.id = 1, .name = "Unlock"},
+};
+static const fsm_event_list_t lock_event_list = {
+    .length = ARRAY_SIZE(lock_events), .events = lock_events};
+static const fsm_state_t lock_states[2];
+
+static const fsm_state_t *lock_l0_guard(const fsm_event_t *event) {
+  return event->id == 0 ? &lock_states[1] : NULL;
+}
+
+static const fsm_state_t *lock_l1_guard(const fsm_event_t *event) {
+  (void)event;
+  return NULL;
+}
+
+static const fsm_state_t lock_states[2] = {
+    {.id = 0,
+     .name = "Open",
+     .transition = {.name = "Lock", .guard = lock_l0_guard}},
+    {.id = 1,
+     .name = "Locked",
+     .transition = {.name = "Stuck", .guard = lock_l1_guard}},
+};
+static const fsm_state_list_t lock_state_list = {
+    .length = ARRAY_SIZE(lock_states), .states = lock_states};
+
+static const fsm_event_t ring_events[] = {
+    {.id = 0, .name = "Tick"},
+};
+static const fsm_event_list_t ring_event_list = {
+    .length = ARRAY_SIZE(ring_events), .events = ring_events};
+static const fsm_state_t ring_states[3];
+
+static const fsm_state_t *ring_r0_guard(const fsm_event_t *event) {
+  return event->id == 0 ? &ring_states[1] : NULL;
+}
+
+static const fsm_state_t *ring_r1_guard(const fsm_event_t *event) {
+  return event->id == 0 ? &ring_states[2] : NULL;
+}
+
+static const fsm_state_t *ring_r2_guard(const fsm_event_t *event) {
+  return event->id == 0 ? &ring_states[0] : NULL;
+}
+
+static const fsm_state_t ring_states[3] = {
+    {.id = 0,
+     .name = "Ring_0",
+     .transition = {.name = "Ring_0", .guard = ring_r0_guard}},
+    {.id = 1,
+     .name = "Ring_1",
+     .transition = {.name = "Ring_1", .guard = ring_r1_guard}},
+    {.id = 2,
+     .name = "Ring_2",
+     .transition = {.name = "Ring_2", .guard = ring_r2_guard}},
+};
+static const fsm_state_list_t ring_state_list = {
+    .length = ARRAY_SIZE(ring_states), .states = ring_states};
+
+int TEST_explore(int argc, char const *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  fsm_t ex;
+  fsm_t lock;
+  fsm_t ring;
+  fsm_explore_report_t report;
+
+  fsm_init(&ex, "ex", &ex_state_list, NULL, &ex_event_list);
+  fsm_init(&lock, "lock", &lock_state_list, NULL, &lock_event_list);
+  fsm_init(&ring, "ring", &ring_state_list, NULL, &ring_event_list);
+
+  const fsm_t *ex_only[] = {&ex};
+  const fsm_t *lock_only[] = {&lock};
+  const fsm_t *both[] = {&ex, &lock};
+  const fsm_t *ring_only[] = {&ring};
+
+  // shortest path to termination
+  assert(fsm_explore(ex_only, 1, FSM_EXPLORE_CHECK_TERMINATE, 2, 1 << 16,
+                     &report) == FSM_EXPLORE_TERMINATE);
+  assert(report.trace_length == 4);
+  assert(!strcmp(report.trace[0], "Event_1"));
+  assert(!strcmp(report.trace[1], "Event_2"));
+  assert(!strcmp(report.trace[2], "Event_3"));
+  assert(!strcmp(report.trace[3], "Event_2"));
+  assert(report.violation[0] == (const fsm_state_t *)&FSM_TERMINATE_STATE);
+  fsm_explore_report_free(&report);
+
+  // terminating is not a deadlock
+  assert(fsm_explore(ex_only, 1, FSM_EXPLORE_CHECK_DEADLOCK, 2, 1 << 16,
+                     &report) == FSM_EXPLORE_OK);
+  assert(report.states == ex_state_list.length + 1);
+  fsm_explore_report_free(&report);
+
+  assert(fsm_explore(lock_only, 1, FSM_EXPLORE_CHECK_DEADLOCK, 2, 1 << 16,
+                     &report) == FSM_EXPLORE_DEADLOCK);
+  assert(report.trace_length == 1);
+  assert(report.violation[0] == &lock_states[1]);
+  fsm_explore_report_free(&report);
+
+  // Event_1 is shared, the lock is stuck once ex terminated
+  assert(fsm_explore(both, 2, FSM_EXPLORE_CHECK_DEADLOCK, 4, 1 << 16,
+                     &report) == FSM_EXPLORE_DEADLOCK);
+  assert(report.trace_length == 4);
+  assert(report.violation[0] == (const fsm_state_t *)&FSM_TERMINATE_STATE);
+  assert(report.violation[1] == &lock_states[1]);
+  fsm_explore_report_free(&report);
+
+  assert(fsm_explore(both, 2, FSM_EXPLORE_CHECK_TERMINATE, 4, 1 << 16,
+                     &report) == FSM_EXPLORE_TERMINATE);
+  assert(report.violation[1] == &lock_states[1]);
+  fsm_explore_report_free(&report);
+
+  assert(fsm_explore(both, 2, FSM_EXPLORE_CHECK_DEADLOCK, 1, 64, &report) ==
+         FSM_EXPLORE_BUDGET);
+  fsm_explore_report_free(&report);
+
+  // 96 bytes hold 4 slots, a limit of 3 states: the ring fills it exactly and
+  // revisiting Ring_0 is not over budget
+  for (size_t threads = 1; threads <= 2; threads++) {
+    assert(fsm_explore(ring_only, 1, FSM_EXPLORE_CHECK_DEADLOCK, threads, 96,
+                       &report) == FSM_EXPLORE_OK);
+    assert(report.states == ring_state_list.length);
+    fsm_explore_report_free(&report);
+  }
+
+  return 0;
+}
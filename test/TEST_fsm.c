@@ -30,11 +30,277 @@
  * SOFTWARE.
  */
 #include "fsm.h"
+#include "fsm_table.h"
+#include "../example/fsm_ex.h"
+
+#include <assert.h>
+
+static void TEST_fsm_resume(fsm_waiter_t *waiter, const fsm_state_t *state) {
+  *(const fsm_state_t **)waiter->ctx = state;
+}
+
+static void TEST_fsm_wait(void) {
+
+  fsm_t fsm;
+  const fsm_state_t *any = NULL;
+  const fsm_state_t *entered = NULL;
+  const fsm_state_t *cancelled = NULL;
+  fsm_waiter_t any_waiter = {.state = NULL, .resume = TEST_fsm_resume};
+  fsm_waiter_t state_waiter = {.state = &ex_state_list.states[2],
+                               .resume = TEST_fsm_resume};
+  fsm_waiter_t cancel_waiter = {.state = &ex_state_list.states[1],
+                                .resume = TEST_fsm_resume};
+
+  any_waiter.ctx = (void *)&any;
+  state_waiter.ctx = (void *)&entered;
+  cancel_waiter.ctx = (void *)&cancelled;
+
+  fsm_init(&fsm, "wait", &ex_state_list, NULL, &ex_event_list);
+
+  fsm_wait(&fsm, &state_waiter);
+  fsm_wait(&fsm, &cancel_waiter);
+  assert(fsm_wait_cancel(&fsm, &cancel_waiter) == 0);
+  assert(fsm_wait_cancel(&fsm, &cancel_waiter) == -1);
+
+  fsm_mainloop(&fsm);
+  fsm_wait(&fsm, &any_waiter);
+
+  fsm_event_put(&fsm, &ex_event_list.events[1]);
+  fsm_mainloop(&fsm);
+  assert(any == &ex_state_list.states[1]);
+  assert(entered == NULL);
+
+  fsm_event_put(&fsm, &ex_event_list.events[2]);
+  fsm_mainloop(&fsm);
+  assert(entered == &ex_state_list.states[2]);
+  assert(cancelled == NULL);
+  assert(fsm.waiters == NULL);
+  assert(fsm.waiting == 0);
+
+  // waiters of other states are left alone until the machine terminates
+  enum { N = 64 };
+  fsm_waiter_t waiters[N];
+  const fsm_state_t *resumed[N];
+  for (int i = 0; i < N; i++) {
+    waiters[i].state = &ex_state_list.states[i % 2 ? 0 : 3];
+    waiters[i].resume = TEST_fsm_resume;
+    waiters[i].ctx = (void *)&resumed[i];
+    resumed[i] = NULL;
+    fsm_wait(&fsm, &waiters[i]);
+  }
+  assert(fsm.waiting == N);
+
+  fsm_event_put(&fsm, &ex_event_list.events[3]);
+  fsm_mainloop(&fsm);
+  for (int i = 0; i < N; i++) {
+    assert(resumed[i] == (i % 2 ? NULL : &ex_state_list.states[3]));
+  }
+  assert(fsm.waiting == N / 2);
+  assert(fsm_wait_cancel(&fsm, &waiters[1]) == 0);
+
+  fsm_event_put(&fsm, &ex_event_list.events[2]);
+  fsm_mainloop(&fsm);
+  for (int i = 3; i < N; i += 2) {
+    assert(resumed[i] == (const fsm_state_t *)&FSM_TERMINATE_STATE);
+  }
+  assert(resumed[1] == NULL);
+  assert(fsm.waiting == 0);
+}
+
+#define TEST_FSM_ROWS_EVENT_NUM (40)
+
+static fsm_event_t rows_events[TEST_FSM_ROWS_EVENT_NUM];
+static const fsm_event_list_t rows_event_list = {
+    .length = ARRAY_SIZE(rows_events), .events = rows_events};
+static const fsm_state_t rows_states[3];
+static int rows_actions;
+
+static bool rows_never(const fsm_event_t *event) {
+  (void)event;
+  return false;
+}
+
+static void rows_action(const fsm_event_t *event) {
+  (void)event;
+  rows_actions++;
+}
+
+static const fsm_state_t *rows_s2_guard(const fsm_event_t *event) {
+  return event->id == 0 ? &rows_states[0] : NULL;
+}
+
+static uint32_t rows_s0_handled[FSM_EVENT_MASK_WORDS(TEST_FSM_ROWS_EVENT_NUM)];
+static const fsm_row_t rows_s0[] = {
+    {.event_id = 5, .target = &rows_states[2], .guard = rows_never},
+    {.event_id = 5, .target = &rows_states[1], .action = rows_action},
+    {.event_id = 33, .target = &rows_states[2], .action = rows_action},
+};
+static const fsm_row_list_t rows_s0_list = {
+    .length = ARRAY_SIZE(rows_s0), .rows = rows_s0, .handled = rows_s0_handled};
+
+static uint32_t rows_s1_handled[FSM_EVENT_MASK_WORDS(TEST_FSM_ROWS_EVENT_NUM)];
+static const fsm_row_t rows_s1[] = {
+    {.event_id = 39, .target = (const fsm_state_t *)&FSM_TERMINATE_STATE},
+};
+static const fsm_row_list_t rows_s1_list = {
+    .length = ARRAY_SIZE(rows_s1), .rows = rows_s1, .handled = rows_s1_handled};
+
+static const fsm_state_t rows_states[3] = {
+    {.id = 0,
+     .name = "Rows_0",
+     .transition = {.name = "Rows_0", .row_list = &rows_s0_list}},
+    {.id = 1,
+     .name = "Rows_1",
+     .transition = {.name = "Rows_1", .row_list = &rows_s1_list}},
+    {.id = 2,
+     .name = "Guard_2",
+     .transition = {.name = "Guard_2", .guard = rows_s2_guard}},
+};
+static const fsm_state_list_t rows_state_list = {
+    .length = ARRAY_SIZE(rows_states), .states = rows_states};
+
+static void TEST_fsm_rows(void) {
+
+  fsm_t fsm;
+
+  for (int i = 0; i < TEST_FSM_ROWS_EVENT_NUM; i++) {
+    rows_events[i].id = i;
+    rows_events[i].name = "Event";
+  }
+
+  fsm_init(&fsm, "rows", &rows_state_list, NULL, &rows_event_list);
+
+  assert(rows_s0_handled[0] == (UINT32_C(1) << 5));
+  assert(rows_s0_handled[1] == (UINT32_C(1) << 1));
+  assert(fsm_transition_next(&rows_states[0], &rows_events[6], NULL) == NULL);
+
+  assert(rows_s1_handled[1] == (UINT32_C(1) << (39 - 32)));
+
+  // a second instance takes a non zero mask as built and does not write it
+  fsm_t other;
+  rows_s1_handled[0] = UINT32_C(1) << 3;
+  fsm_init(&other, "rows", &rows_state_list, NULL, &rows_event_list);
+  assert(rows_s0_handled[0] == (UINT32_C(1) << 5));
+  assert(rows_s1_handled[0] == (UINT32_C(1) << 3));
+  rows_s1_handled[0] = 0;
+
+  fsm_event_put(&fsm, &rows_events[33]);
+  fsm_event_put(&fsm, &rows_events[1]);
+  fsm_event_put(&fsm, &rows_events[0]);
+  fsm_event_put(&fsm, &rows_events[5]);
+  fsm_mainloop(&fsm);
+
+  assert(fsm.cur_state == &rows_states[1]);
+  assert(rows_actions == 2);
+
+  fsm_event_put(&fsm, &rows_events[39]);
+  fsm_mainloop(&fsm);
+
+  assert(fsm.cur_state == (const fsm_state_t *)&FSM_TERMINATE_STATE);
+}
+
+static void TEST_fsm_by_name(void) {
+
+  fsm_t fsm;
+
+  fsm_init(&fsm, "name", &ex_state_list, NULL, &ex_event_list);
+
+  assert(ex_event_list.index->base != NULL);
+  assert(fsm_event_by_name(&fsm, "Event_2") == &ex_event_list.events[2]);
+  assert(fsm_event_by_name(&fsm, "Event_4") == NULL);
+  assert(fsm_state_by_name(&fsm, "State_3") == &ex_state_list.states[3]);
+  assert(fsm_state_by_name(&fsm, "") == NULL);
+  assert(fsm_event_put_by_name(&fsm, "Event_1") == 1);
+  assert(fsm_event_put_by_name(&fsm, "Event") == -1);
+
+  fsm_mainloop(&fsm);
+  assert(fsm.cur_state == &ex_state_list.states[1]);
+
+  // no index, linear scan
+  fsm_init(&fsm, "name", &rows_state_list, NULL, &rows_event_list);
+  assert(fsm_state_by_name(&fsm, "Guard_2") == &rows_states[2]);
+  assert(fsm_state_by_name(&fsm, "State_3") == NULL);
+}
+
+static const fsm_state_t defer_states[3];
+static int defer_entries;
+
+static void defer_s0_on_entry(void) { defer_entries++; }
+
+static const fsm_state_t *defer_s0_guard(const fsm_event_t *event) {
+  return event->id == 0 ? &defer_states[1] : NULL;
+}
+
+static const fsm_state_t *defer_s1_guard(const fsm_event_t *event) {
+  return event->id == 1 ? &defer_states[2] : NULL;
+}
+
+static const fsm_state_t *defer_s2_guard(const fsm_event_t *event) {
+  return event->id == 3 ? &defer_states[0] : NULL;
+}
+
+// Event_3 is held in State_0 and State_1
+static const uint32_t defer_event_3[FSM_EVENT_MASK_WORDS(4)] = {1u << 3};
+
+static const fsm_state_t defer_states[3] = {
+    {.id = 0,
+     .name = "State_0",
+     .on_entry = defer_s0_on_entry,
+     .transition = {.name = "Defer_0", .guard = defer_s0_guard},
+     .defer = defer_event_3},
+    {.id = 1,
+     .name = "State_1",
+     .transition = {.name = "Defer_1", .guard = defer_s1_guard},
+     .defer = defer_event_3},
+    {.id = 2,
+     .name = "State_2",
+     .transition = {.name = "Defer_2", .guard = defer_s2_guard}},
+};
+static const fsm_state_list_t defer_state_list = {
+    .length = ARRAY_SIZE(defer_states), .states = defer_states};
+
+static void TEST_fsm_defer(void) {
+
+  fsm_t fsm;
+  const int held[] = {3, 0, 3, 2, 1};
+  const int cycle[] = {0, 1};
+
+  fsm_table_t table;
+
+  // deferral needs the queue, the tabulated form can't represent it
+  assert(fsm_state_list_defers(&defer_state_list));
+  assert(!fsm_state_list_defers(&ex_state_list));
+  assert(fsm_table_build(&table, &defer_state_list, &ex_event_list) == -1);
+
+  fsm_init(&fsm, "defer", &defer_state_list, NULL, &ex_event_list);
+
+  assert(fsm_dispatch(&fsm, held, 2) == 2);
+  assert(fsm.cur_state == &defer_states[1]);
+  assert(queue_size(&fsm.deferred) == 1);
+  assert(defer_entries == 1);
+
+  // the first Event_3 is delivered in State_2, the second one held again in
+  // State_0, Event_2 is not deferred and dropped
+  assert(fsm_dispatch(&fsm, &held[2], 3) == 3);
+  assert(fsm.cur_state == &defer_states[0]);
+  assert(queue_size(&fsm.deferred) == 1);
+  assert(defer_entries == 2);
+
+  assert(fsm_dispatch(&fsm, cycle, ARRAY_SIZE(cycle)) == ARRAY_SIZE(cycle));
+  assert(fsm.cur_state == &defer_states[0]);
+  assert(queue_is_empty(&fsm.deferred));
+  assert(defer_entries == 3);
+}
 
 int TEST_fsm(int argc, char const *argv[]) {
 
   (void)argc;
   (void)argv;
 
+  TEST_fsm_wait();
+  TEST_fsm_rows();
+  TEST_fsm_by_name();
+  TEST_fsm_defer();
+
   return 0;
 }
@@ -0,0 +1,109 @@
+/**
+ * @file TEST_hot.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_hot.h"
+#include "../example/fsm_ex.h"
+
+#include <assert.h>
+
+static int TEST_hot_released;
+
+static void TEST_hot_release(const fsm_def_t *def) {
+  (void)def;
+  TEST_hot_released++;
+}
+
+int TEST_hot(int argc, char const *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  // same machine, states rotated by two
+  const int rotate[] = {2, 3, 0, 1};
+  const fsm_def_t v0 = {.state_list = &ex_state_list,
+                        .event_list = &ex_event_list,
+                        .release = TEST_hot_release};
+  const fsm_def_t v1 = {.state_list = &ex_state_list,
+                        .event_list = &ex_event_list,
+                        .state_map = rotate,
+                        .map_length = ARRAY_SIZE(rotate),
+                        .release = TEST_hot_release};
+  fsm_hot_instance_t a;
+  fsm_hot_instance_t b;
+
+  fsm_hot_t *hot = fsm_hot_create(&v0, 1);
+  assert(hot);
+
+  fsm_hot_enter(hot, 0);
+  fsm_hot_attach(hot, &a);
+  fsm_hot_attach(hot, &b);
+  assert(fsm_hot_dispatch(hot, &a, 0) == 0);
+  assert(fsm_hot_dispatch(hot, &a, 1) == 1);
+  assert(fsm_hot_dispatch(hot, &a, 4) == -1);
+  assert(fsm_hot_state(hot, &a) == &ex_state_list.states[1]);
+  fsm_hot_leave(hot, 0);
+
+  // both instances still refer to the first version
+  assert(fsm_hot_swap(hot, &v1) == 1);
+  assert(fsm_hot_reclaim(hot) == 2);
+
+  // migration happens lazily on the next event
+  fsm_hot_enter(hot, 0);
+  assert(fsm_hot_dispatch(hot, &a, 2) == 1);
+  assert(fsm_hot_state(hot, &a) ==
+         (const fsm_state_t *)&FSM_TERMINATE_STATE);
+  assert(fsm_hot_state(hot, &b) == &ex_state_list.states[2]);
+
+  // retired but observable from the section still open
+  assert(fsm_hot_reclaim(hot) == 2);
+  assert(TEST_hot_released == 0);
+  fsm_hot_leave(hot, 0);
+
+  assert(fsm_hot_reclaim(hot) == 1);
+  assert(TEST_hot_released == 1);
+
+  // a terminated instance stays terminated across versions
+  assert(fsm_hot_swap(hot, &v1) == 2);
+  fsm_hot_enter(hot, 0);
+  assert(fsm_hot_dispatch(hot, &a, 0) == 0);
+  assert(fsm_hot_state(hot, &a) ==
+         (const fsm_state_t *)&FSM_TERMINATE_STATE);
+  assert(fsm_hot_state(hot, &b) == &ex_state_list.states[0]);
+  fsm_hot_detach(hot, &a);
+  fsm_hot_detach(hot, &b);
+  fsm_hot_leave(hot, 0);
+
+  assert(fsm_hot_reclaim(hot) == 1);
+  fsm_hot_destroy(hot);
+  assert(TEST_hot_released == 3);
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file TEST_image.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_image.h"
+#include "fsm_table.h"
+#include "../example/fsm_ex.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int TEST_image(int argc, char const *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  char path[] = "/tmp/TEST_imageXXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+
+  FILE *stream = fdopen(fd, "w+b");
+  assert(stream);
+  assert(fsm_image_write(stream, "ex", &ex_state_list, NULL,
+                         &ex_event_list) == 0);
+
+  long size = ftell(stream);
+  uint32_t *buf = (uint32_t *)malloc((size_t)size);
+  assert(buf);
+  rewind(stream);
+  assert(fread(buf, 1, (size_t)size, stream) == (size_t)size);
+  fclose(stream);
+
+  fsm_image_t image;
+  fsm_table_t table;
+
+  assert(fsm_image_open(&image, buf, (size_t)size, FSM_IMAGE_VERIFY) == 0);
+  assert(fsm_table_build(&table, &ex_state_list, &ex_event_list) == 0);
+
+  assert(!strcmp(fsm_image_name(&image), "ex"));
+  assert(image.header->states == ex_state_list.length);
+  assert(image.header->events == ex_event_list.length);
+
+  // same transitions as the definition it was written from
+  for (uint32_t s = 0; s <= image.header->states; s++) {
+    for (uint32_t e = 0; e < image.header->events; e++) {
+      int next = fsm_image_next(&image, s, e);
+      assert(next < 0 ? table.next[s * table.events + e] == s
+                      : table.next[s * table.events + e] == (uint32_t)next);
+    }
+  }
+  assert(fsm_image_next(&image, 1, 1) == 1);
+
+  for (uint32_t s = 0; s < image.header->states; s++) {
+    assert(!strcmp(fsm_image_state_name(&image, s),
+                   ex_state_list.states[s].name));
+    assert(fsm_image_state_find(&image, ex_state_list.states[s].name) ==
+           (int)s);
+  }
+  assert(!strcmp(fsm_image_state_name(&image, image.header->states),
+                 FSM_TERMINATE_STATE.name));
+  assert(fsm_image_event_find(&image, "Event_3") == 3);
+  assert(!strcmp(fsm_image_event_name(&image, 2), "Event_2"));
+  assert(fsm_image_event_find(&image, "Event_4") == -1);
+  assert(fsm_image_state_find(&image, "") == -1);
+
+  // a corrupted byte is only caught when verifying
+  ((uint8_t *)buf)[size - 8] ^= 1;
+  assert(fsm_image_open(&image, buf, (size_t)size, 0) == 0);
+  assert(fsm_image_open(&image, buf, (size_t)size, FSM_IMAGE_VERIFY) == -1);
+  assert(fsm_image_open(&image, buf, sizeof(fsm_image_header_t), 0) == -1);
+
+  assert(fsm_image_map(&image, path, FSM_IMAGE_VERIFY) == 0);
+  assert(image.mapped);
+  assert(fsm_image_next(&image, 3, 2) == (int)image.header->states);
+  fsm_image_unmap(&image);
+
+  unlink(path);
+  fsm_table_free(&table);
+  free(buf);
+
+  return 0;
+}
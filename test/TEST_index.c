@@ -0,0 +1,98 @@
+/**
+ * @file TEST_index.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_index.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct TEST_index_item_s {
+  int id;
+  const char *name;
+} TEST_index_item_t;
+
+int TEST_index(int argc, char const *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  enum { N = 1000 };
+  static char names[N][20];
+  static TEST_index_item_t items[N];
+  fsm_name_index_t index;
+
+  for (int i = 0; i < N; i++) {
+    snprintf(names[i], sizeof(names[i]), "Event_%d", i);
+    items[i].id = i;
+    items[i].name = names[i];
+  }
+
+  assert(fsm_name_index_build(&index, items, N, sizeof(items[0]),
+                              offsetof(TEST_index_item_t, name)) == 0);
+
+  for (int i = 0; i < N; i++) {
+    assert(fsm_name_index_find(&index, names[i]) == i);
+  }
+  assert(fsm_name_index_find(&index, "Event_1000") == -1);
+  assert(fsm_name_index_find(&index, "") == -1);
+
+  fsm_name_index_free(&index);
+  assert(fsm_name_index_find(&index, "Event_0") == -1);
+
+  // duplicated names cannot be perfectly hashed
+  items[1].name = items[0].name;
+  assert(fsm_name_index_build(&index, items, 2, sizeof(items[0]),
+                              offsetof(TEST_index_item_t, name)) == -1);
+  assert(index.base == NULL && index.state == FSM_INDEX_FAILED);
+
+  // a failed build is not retried
+  assert(fsm_name_index_build_once(&index, items, 1, sizeof(items[0]),
+                                   offsetof(TEST_index_item_t, name)) == -1);
+  assert(index.base == NULL);
+  fsm_name_index_free(&index);
+
+  // built once, later calls find it built
+  assert(fsm_name_index_build_once(&index, items, 1, sizeof(items[0]),
+                                   offsetof(TEST_index_item_t, name)) == 0);
+  assert(index.state == FSM_INDEX_BUILT);
+  assert(fsm_name_index_build_once(&index, items, 1, sizeof(items[0]),
+                                   offsetof(TEST_index_item_t, name)) == 0);
+  assert(fsm_name_index_find(&index, "Event_0") == 0);
+  fsm_name_index_free(&index);
+
+  assert(fsm_name_index_build(&index, items, 0, sizeof(items[0]),
+                              offsetof(TEST_index_item_t, name)) == 0);
+  assert(fsm_name_index_find(&index, "Event_0") == -1);
+  fsm_name_index_free(&index);
+
+  return 0;
+}
@@ -32,5 +32,28 @@
 #include "fsm.h"
 
 extern int TEST_fsm(int argc, char const *argv[]);
+extern int TEST_runtime(int argc, char const *argv[]);
+extern int TEST_index(int argc, char const *argv[]);
+extern int TEST_parallel(int argc, char const *argv[]);
+extern int TEST_explore(int argc, char const *argv[]);
+extern int TEST_markov(int argc, char const *argv[]);
+extern int TEST_hot(int argc, char const *argv[]);
+extern int TEST_region(int argc, char const *argv[]);
+extern int TEST_image(int argc, char const *argv[]);
 
-int main(int argc, char const *argv[]) { TEST_fsm(argc, argv); }
\ No newline at end of file
+int main(int argc, char const *argv[]) {
+
+  int res = 0;
+
+  res |= TEST_fsm(argc, argv);
+  res |= TEST_runtime(argc, argv);
+  res |= TEST_index(argc, argv);
+  res |= TEST_parallel(argc, argv);
+  res |= TEST_explore(argc, argv);
+  res |= TEST_markov(argc, argv);
+  res |= TEST_hot(argc, argv);
+  res |= TEST_region(argc, argv);
+  res |= TEST_image(argc, argv);
+
+  return res;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+/**
+ * @file TEST_markov.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_markov.h"
+#include "../example/fsm_ex.h"
+
+#include <assert.h>
+#include <math.h>
+
+static bool TEST_markov_near(double a, double b) { return fabs(a - b) < 1e-6; }
+
+int TEST_markov(int argc, char const *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  const double uniform[] = {1, 1, 1, 1};
+  const double no_event_2[] = {0.5, 0.5, 0, 0};
+  const double never[] = {0, 0, 0, 0};
+  fsm_markov_t markov;
+  double steps[5];
+  double distribution[5];
+  double frequency[5 * 4];
+
+  assert(fsm_markov_init(&markov, &ex_state_list, &ex_event_list, never) ==
+         -1);
+
+  assert(fsm_markov_init(&markov, &ex_state_list, &ex_event_list, uniform) ==
+         0);
+  assert(markov.states == 5);
+  // State_1 moves to State_2 or stays, terminate only stays
+  assert(markov.row[2] - markov.row[1] == 2);
+  assert(markov.row[5] - markov.row[4] == 1);
+  assert(markov.row[5] < markov.states * markov.events);
+
+  assert(fsm_markov_steps(&markov, steps, 1e-12, 10000) > 0);
+  assert(TEST_markov_near(steps[0], 28));
+  assert(TEST_markov_near(steps[1], 24));
+  assert(TEST_markov_near(steps[2], 20));
+  assert(TEST_markov_near(steps[3], 16));
+  assert(steps[4] == 0);
+
+  assert(fsm_markov_stationary(&markov, 0, distribution, 1e-12, 100000) > 0);
+  assert(TEST_markov_near(distribution[4], 1));
+
+  fsm_markov_free(&markov);
+
+  // State_1 is a trap when Event_2 never happens
+  assert(fsm_markov_init(&markov, &ex_state_list, &ex_event_list,
+                         no_event_2) == 0);
+
+  assert(fsm_markov_steps(&markov, steps, 1e-12, 10000) > 0);
+  assert(isinf(steps[0]) && isinf(steps[3]));
+
+  assert(fsm_markov_stationary(&markov, 3, distribution, 1e-12, 100000) > 0);
+  assert(TEST_markov_near(distribution[1], 1));
+
+  fsm_markov_frequencies(&markov, distribution, frequency);
+  assert(TEST_markov_near(frequency[1 * 4 + 1], 0.5));
+  assert(frequency[1 * 4 + 2] == 0);
+  // State_1 does not handle Event_0
+  assert(frequency[1 * 4 + 0] == 0);
+
+  fsm_markov_free(&markov);
+
+  return 0;
+}
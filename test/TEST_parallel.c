@@ -0,0 +1,86 @@
+/**
+ * @file TEST_parallel.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_parallel.h"
+#include "../example/fsm_ex.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+int TEST_parallel(int argc, char const *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  enum { N = 100000 };
+  int *event_ids = (int *)malloc(N * sizeof(int));
+  const fsm_state_t *final_state;
+  fsm_t fsm;
+
+  assert(event_ids != NULL);
+
+  // random log which never terminates
+  srand(1);
+  fsm_init(&fsm, "gen", &ex_state_list, NULL, &ex_event_list);
+  for (size_t i = 0; i < N; i++) {
+    event_ids[i] = rand() % 4;
+    if (fsm.cur_state == &ex_state_list.states[3] && event_ids[i] == 2) {
+      event_ids[i] = 0;
+    }
+    fsm_dispatch(&fsm, &event_ids[i], 1);
+  }
+  event_ids[N / 2] = 7; // unknown, ignored
+
+  for (size_t len = 0; len <= N; len += N / 4) {
+
+    fsm_init(&fsm, "ref", &ex_state_list, NULL, &ex_event_list);
+    assert(fsm_dispatch(&fsm, event_ids, len) == len);
+
+    for (size_t threads = 1; threads <= 8; threads *= 2) {
+      assert(fsm_recognize(&ex_state_list, &ex_event_list, NULL, event_ids,
+                           len, threads, &final_state) == 0);
+      assert(final_state == fsm.cur_state);
+    }
+  }
+
+  // terminate is absorbing
+  event_ids[0] = 1;
+  event_ids[1] = 2;
+  event_ids[2] = 3;
+  event_ids[3] = 2;
+  assert(fsm_recognize(&ex_state_list, &ex_event_list, NULL, event_ids, N, 4,
+                       &final_state) == 0);
+  assert(final_state == (const fsm_state_t *)&FSM_TERMINATE_STATE);
+
+  free(event_ids);
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file TEST_region.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_region.h"
+#include "../example/fsm_ex.h"
+
+#include <assert.h>
+
+#define TEST_REGION_EVENT_3 (3)
+
+static const fsm_state_t power_states[2];
+static int power_entries;
+
+static void power_on_entry(void) { power_entries++; }
+
+// toggled by Event_3 only
+static uint32_t power_off_handled[FSM_EVENT_MASK_WORDS(4)];
+static const fsm_row_t power_off_rows[] = {
+    {.event_id = TEST_REGION_EVENT_3, .target = &power_states[1]},
+};
+static const fsm_row_list_t power_off_list = {
+    .length = ARRAY_SIZE(power_off_rows),
+    .rows = power_off_rows,
+    .handled = power_off_handled};
+
+static uint32_t power_on_handled[FSM_EVENT_MASK_WORDS(4)];
+static const fsm_row_t power_on_rows[] = {
+    {.event_id = TEST_REGION_EVENT_3, .target = &power_states[0]},
+};
+static const fsm_row_list_t power_on_list = {
+    .length = ARRAY_SIZE(power_on_rows),
+    .rows = power_on_rows,
+    .handled = power_on_handled};
+
+static const fsm_state_t power_states[2] = {
+    {.id = 0,
+     .name = "Off",
+     .on_entry = power_on_entry,
+     .transition = {.name = "Power_0", .row_list = &power_off_list}},
+    {.id = 1,
+     .name = "On",
+     .on_entry = power_on_entry,
+     .transition = {.name = "Power_1", .row_list = &power_on_list}},
+};
+
+static const fsm_state_list_t power_state_list = {
+    .length = ARRAY_SIZE(power_states), .states = power_states};
+
+static const fsm_region_t TEST_regions[] = {
+    {.name = "ex", .state_list = &ex_state_list},
+    {.name = "power", .state_list = &power_state_list},
+};
+
+static void TEST_region_run(size_t cache_size) {
+
+  const int cycle[] = {1, 2, 3, 0};
+  const int last[] = {1, 2, 3, 2, 0};
+  fsm_regions_t regions;
+
+  power_entries = 0;
+
+  assert(fsm_regions_init(&regions, "regions", TEST_regions,
+                          ARRAY_SIZE(TEST_regions), &ex_event_list,
+                          cache_size) == 0);
+
+  // Event_3 is the only event evaluated by both regions
+  assert(regions.handler[1] - regions.handler[0] == 1);
+  assert(regions.handler[4] - regions.handler[3] == 2);
+
+  assert(fsm_regions_state(&regions, 0) == NULL);
+
+  for (int i = 0; i < 4; i++) {
+    assert(fsm_regions_dispatch(&regions, cycle, ARRAY_SIZE(cycle)) ==
+           ARRAY_SIZE(cycle));
+  }
+
+  assert(fsm_regions_state(&regions, 0) == &ex_state_list.states[0]);
+  assert(fsm_regions_state(&regions, 1) == &power_states[0]);
+  assert(power_entries == 5);
+
+  if (cache_size) {
+    // the product states of the first two cycles repeat
+    assert(regions.misses == 8);
+    assert(regions.hits == 8);
+  }
+
+  // the ex region terminates, the power region is still active
+  assert(fsm_regions_dispatch(&regions, last, ARRAY_SIZE(last)) ==
+         ARRAY_SIZE(last));
+  assert(fsm_regions_state(&regions, 0) ==
+         (const fsm_state_t *)&FSM_TERMINATE_STATE);
+  assert(fsm_regions_state(&regions, 1) == &power_states[1]);
+
+  fsm_regions_free(&regions);
+}
+
+int TEST_region(int argc, char const *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  TEST_region_run(0);
+  TEST_region_run(64);
+
+  return 0;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file TEST_runtime.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "fsm_runtime.h"
+#include "../example/fsm_ex.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+
+#define TEST_RUNTIME_RELAY_LENGTH (8)
+#define TEST_RUNTIME_RELAY_HOPS (200001)
+
+static fsm_runtime_t *relay_rt;
+static atomic_int relay_hops;
+static const fsm_state_t relay_states[1];
+
+// pass the event on to the next instance, likely on another shard
+static void relay_action(const fsm_event_t *event) {
+  if (atomic_fetch_add(&relay_hops, 1) + 1 < TEST_RUNTIME_RELAY_HOPS) {
+    int next = (fsm_runtime_self() + 1) % TEST_RUNTIME_RELAY_LENGTH;
+    assert(fsm_runtime_send(relay_rt, next, event->id) == 0);
+  }
+}
+
+static uint32_t relay_handled[FSM_EVENT_MASK_WORDS(4)];
+static const fsm_row_t relay_rows[] = {
+    {.event_id = 0, .target = &relay_states[0], .action = relay_action},
+};
+static const fsm_row_list_t relay_row_list = {.length = ARRAY_SIZE(relay_rows),
+                                              .rows = relay_rows,
+                                              .handled = relay_handled};
+static const fsm_state_t relay_states[1] = {
+    {.id = 0,
+     .name = "Relay",
+     .transition = {.name = "Relay_0", .row_list = &relay_row_list}},
+};
+static const fsm_state_list_t relay_state_list = {
+    .length = ARRAY_SIZE(relay_states), .states = relay_states};
+
+static void TEST_runtime_relay(void) {
+
+  fsm_t fsm[TEST_RUNTIME_RELAY_LENGTH];
+
+  relay_rt = fsm_runtime_create(4, ARRAY_SIZE(fsm));
+  assert(relay_rt != NULL);
+
+  for (size_t i = 0; i < ARRAY_SIZE(fsm); i++) {
+    fsm_init(&fsm[i], "relay", &relay_state_list, NULL, &ex_event_list);
+    assert(fsm_runtime_add(relay_rt, &fsm[i]) == (int)i);
+  }
+
+  atomic_store(&relay_hops, 0);
+
+  assert(fsm_runtime_start(relay_rt) == 0);
+  assert(fsm_runtime_send(relay_rt, 0, 0) == 0);
+
+  // the messages sent by the actions are delivered before the workers exit
+  fsm_runtime_stop(relay_rt);
+  assert(atomic_load(&relay_hops) == TEST_RUNTIME_RELAY_HOPS);
+
+  fsm_runtime_destroy(relay_rt);
+}
+
+static void TEST_runtime_send_n(void) {
+
+  // enough messages to fill several batches per shard
+  enum { N = 3 * FSM_RUNTIME_BATCH_SIZE };
+  fsm_t fsm[N];
+  int instance_ids[4 * N];
+  int event_ids[4 * N];
+  size_t length = 0;
+
+  fsm_runtime_t *rt = fsm_runtime_create(2, N);
+  assert(rt != NULL);
+
+  for (size_t i = 0; i < N; i++) {
+    fsm_init(&fsm[i], "rt", &ex_state_list, NULL, &ex_event_list);
+    assert(fsm_runtime_add(rt, &fsm[i]) == (int)i);
+  }
+
+  // State_0 -[1]-> State_1 -[2]-> State_2 -[3]-> State_3 -[0]-> State_0,
+  // interleaved over the instances, taken in order per instance
+  for (int event = 1; event <= 4; event++) {
+    for (int i = 0; i < N; i++) {
+      if (event - 1 <= i % 4) {
+        instance_ids[length] = i;
+        event_ids[length++] = event % 4;
+      }
+    }
+  }
+
+  instance_ids[0] = N;
+  assert(fsm_runtime_send_n(rt, instance_ids, event_ids, length) == -1);
+  instance_ids[0] = 0;
+
+  assert(fsm_runtime_start(rt) == 0);
+  assert(fsm_runtime_send_n(rt, instance_ids, event_ids, length) == 0);
+  fsm_runtime_stop(rt);
+
+  for (size_t i = 0; i < N; i++) {
+    assert(fsm[i].cur_state == &ex_state_list.states[(i % 4 + 1) % 4]);
+  }
+
+  fsm_runtime_destroy(rt);
+}
+
+int TEST_runtime(int argc, char const *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  TEST_runtime_relay();
+
+  fsm_t fsm[4];
+
+  fsm_runtime_t *rt = fsm_runtime_create(2, ARRAY_SIZE(fsm));
+  assert(rt != NULL);
+
+  for (size_t i = 0; i < ARRAY_SIZE(fsm); i++) {
+    fsm_init(&fsm[i], "rt", &ex_state_list, NULL, &ex_event_list);
+    assert(fsm_runtime_add(rt, &fsm[i]) == (int)i);
+  }
+
+  assert(fsm_runtime_send(rt, (int)ARRAY_SIZE(fsm), 0) == -1);
+  assert(fsm_runtime_send(rt, 0, (int)ex_event_list.length) == -1);
+  assert(fsm_runtime_self() == -1);
+
+  assert(fsm_runtime_start(rt) == 0);
+  assert(fsm_runtime_add(rt, &fsm[0]) == -1);
+
+  for (int i = 0; i < (int)ARRAY_SIZE(fsm); i++) {
+    for (int event_id = 0; event_id <= i; event_id++) {
+      assert(fsm_runtime_send(rt, i, event_id) == 0);
+    }
+  }
+
+  fsm_runtime_stop(rt);
+
+  assert(fsm[0].cur_state == &ex_state_list.states[0]);
+  assert(fsm[1].cur_state == &ex_state_list.states[1]);
+  assert(fsm[2].cur_state == &ex_state_list.states[2]);
+  assert(fsm[3].cur_state == &ex_state_list.states[3]);
+
+  fsm_runtime_destroy(rt);
+
+  TEST_runtime_send_n();
+
+  return 0;
+}
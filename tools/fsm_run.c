@@ -0,0 +1,492 @@
+/**
+ * @file fsm_run.c
+ * @author Ahmed Zamouche (ahmed.zamouche@gmail.com)
+ * @brief
+ * @version 0.1
+ * @date 2019-12-01
+ *
+ *  @copyright Copyright (c) 2019
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Ahmed Zamouche
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "fsm.h"
+#include "fsm_image.h"
+#include "../example/fsm_ex.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FSM_RUN_BATCH (1 << 16)  /**< events per fsm_dispatch call */
+#define FSM_RUN_READ (1 << 22)   /**< stdin read buffer size */
+#define FSM_RUN_NAME_MAX (256)   /**< longest event name accepted */
+#define FSM_RUN_STDOUT (1 << 20) /**< stdout buffer size */
+
+typedef struct fsm_run_machine_s {
+  const char *name;                   /**< */
+  const fsm_state_list_t *state_list; /**< */
+  const fsm_event_list_t *event_list; /**< */
+} fsm_run_machine_t;
+
+static const fsm_run_machine_t machines[] = {
+    {.name = "ex", .state_list = &ex_state_list, .event_list = &ex_event_list},
+};
+
+typedef struct fsm_run_s {
+  fsm_t fsm;                   /**< */
+  const fsm_image_t *image;    /**< runs the image instead of `fsm` */
+  uint32_t state;              /**< current state of the image */
+  bool binary;                 /**< */
+  bool trace;                  /**< */
+  bool done;                   /**< machine terminated */
+  size_t events;               /**< events consumed */
+  size_t unknown;              /**< unknown or truncated event names */
+  size_t partial;              /**< trailing bytes of an incomplete record */
+  int batch[FSM_RUN_BATCH];    /**< */
+  size_t length;               /**< events in batch */
+  char name[FSM_RUN_NAME_MAX]; /**< partial text line */
+  size_t name_length;          /**< */
+  bool name_truncated;         /**< the line is longer than the name buffer */
+} fsm_run_t;
+
+static void fsm_run_usage(FILE *stream) {
+  fprintf(stream, "usage: fsm-run [-m machine | -i image [-n]] [-o image] "
+                  "[-b] [-t] [-s] [file]\n"
+                  "  -m machine  definition to run (default: ex)\n"
+                  "  -i image    run a binary definition, mapped in memory\n"
+                  "  -n          trust the image, only check its header\n"
+                  "              (default: verify the checksum and records)\n"
+                  "  -o image    write the binary definition of the machine "
+                  "and exit\n"
+                  "  -b          binary input, little-endian uint32 event ids\n"
+                  "              (default: text, one event name per line)\n"
+                  "  -t          print every state entered\n"
+                  "  -s          print statistics to stderr\n"
+                  "  file        input file, mapped in memory (default: "
+                  "stdin)\n");
+}
+
+static void fsm_run_trace(fsm_waiter_t *waiter, const fsm_state_t *state) {
+
+  fsm_run_t *run = (fsm_run_t *)waiter->ctx;
+
+  fputs(state->name, stdout);
+  fputc('\n', stdout);
+
+  if (state != (const fsm_state_t *)&FSM_TERMINATE_STATE) {
+    fsm_wait(&run->fsm, waiter);
+  }
+}
+
+static bool fsm_run_terminated(const fsm_run_t *run) {
+
+  if (run->image) {
+    return run->state == run->image->header->states;
+  }
+
+  return run->fsm.cur_state == (const fsm_state_t *)&FSM_TERMINATE_STATE;
+}
+
+static const char *fsm_run_state_name(const fsm_run_t *run) {
+
+  if (run->image) {
+    return fsm_image_state_name(run->image, run->state);
+  }
+
+  return run->fsm.cur_state->name;
+}
+
+static size_t fsm_run_dispatch(fsm_run_t *run, const int *event_ids,
+                               size_t length) {
+
+  if (run->image == NULL) {
+    return fsm_dispatch(&run->fsm, event_ids, length);
+  }
+
+  for (size_t i = 0; i < length; i++) {
+    int next = fsm_image_next(run->image, run->state, (uint32_t)event_ids[i]);
+    if (next < 0) {
+      if ((uint32_t)event_ids[i] >= run->image->header->events) {
+        fprintf(stderr, "warning: fsm `%s`, unknown event id %d\r\n",
+                fsm_image_name(run->image), event_ids[i]);
+      }
+      continue;
+    }
+    run->state = (uint32_t)next;
+    if (run->trace) {
+      fputs(fsm_run_state_name(run), stdout);
+      fputc('\n', stdout);
+    }
+    if (fsm_run_terminated(run)) {
+      return i + 1;
+    }
+  }
+
+  return length;
+}
+
+static void fsm_run_flush(fsm_run_t *run) {
+
+  if (run->length && !run->done) {
+    size_t consumed = fsm_run_dispatch(run, run->batch, run->length);
+    run->events += consumed;
+    run->done = consumed < run->length || fsm_run_terminated(run);
+  }
+
+  run->length = 0;
+}
+
+static void fsm_run_push(fsm_run_t *run, int event_id) {
+
+  run->batch[run->length++] = event_id;
+
+  if (run->length == FSM_RUN_BATCH) {
+    fsm_run_flush(run);
+  }
+}
+
+static void fsm_run_name(fsm_run_t *run) {
+
+  if (run->name_length && run->name[run->name_length - 1] == '\r') {
+    run->name_length--;
+  }
+
+  if (run->name_truncated) {
+    fprintf(stderr,
+            "warning: event name longer than %d bytes, ignored\r\n",
+            FSM_RUN_NAME_MAX - 1);
+    run->name_truncated = false;
+    run->name_length = 0;
+    run->unknown++;
+    return;
+  }
+
+  if (run->name_length == 0) {
+    return;
+  }
+
+  run->name[run->name_length] = '\0';
+  run->name_length = 0;
+
+  int event_id = -1;
+
+  if (run->image) {
+    event_id = fsm_image_event_find(run->image, run->name);
+  } else {
+    const fsm_event_t *event = fsm_event_by_name(&run->fsm, run->name);
+    event_id = event ? event->id : -1;
+  }
+
+  if (event_id >= 0) {
+    fsm_run_push(run, event_id);
+  } else {
+    run->unknown++;
+  }
+}
+
+static void fsm_run_text(fsm_run_t *run, const char *buf, size_t size) {
+
+  const char *end = buf + size;
+
+  while (buf < end && !run->done) {
+    const char *eol = (const char *)memchr(buf, '\n', (size_t)(end - buf));
+    size_t length = (size_t)((eol ? eol : end) - buf);
+
+    if (run->name_length + length >= FSM_RUN_NAME_MAX) {
+      length = FSM_RUN_NAME_MAX - 1 - run->name_length;
+      run->name_truncated = true;
+    }
+
+    memcpy(&run->name[run->name_length], buf, length);
+    run->name_length += length;
+
+    if (eol == NULL) {
+      return;
+    }
+
+    fsm_run_name(run);
+    buf = eol + 1;
+  }
+}
+
+static size_t fsm_run_binary(fsm_run_t *run, const uint8_t *buf, size_t size) {
+
+  size_t count = size / sizeof(uint32_t);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if (((uintptr_t)buf % sizeof(int)) == 0) {
+    // dispatch straight from the input buffer
+    fsm_run_flush(run);
+    for (size_t i = 0; i < count && !run->done; i += FSM_RUN_BATCH) {
+      size_t length = count - i < FSM_RUN_BATCH ? count - i : FSM_RUN_BATCH;
+      size_t consumed =
+          fsm_run_dispatch(run, (const int *)(const void *)buf + i, length);
+      run->events += consumed;
+      run->done = consumed < length || fsm_run_terminated(run);
+    }
+    return count * sizeof(uint32_t);
+  }
+#endif
+
+  for (size_t i = 0; i < count && !run->done; i++) {
+    const uint8_t *p = &buf[i * sizeof(uint32_t)];
+    fsm_run_push(run, (int)((uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                            (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24));
+  }
+
+  return count * sizeof(uint32_t);
+}
+
+static void fsm_run_partial(fsm_run_t *run, size_t bytes) {
+
+  if (bytes && !run->done) {
+    fprintf(stderr,
+            "warning: %zu trailing bytes, not a whole event id, ignored\r\n",
+            bytes);
+    run->partial += bytes;
+  }
+}
+
+static int fsm_run_mapped(fsm_run_t *run, const char *path) {
+
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+
+  if (fd < 0 || fstat(fd, &st)) {
+    perror(path);
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+
+  if (st.st_size == 0) {
+    close(fd);
+    return 0;
+  }
+
+  void *buf = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (buf == MAP_FAILED) {
+    perror(path);
+    return -1;
+  }
+
+  posix_madvise(buf, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+  if (run->binary) {
+    size_t used = fsm_run_binary(run, (const uint8_t *)buf, (size_t)st.st_size);
+    fsm_run_partial(run, (size_t)st.st_size - used);
+  } else {
+    fsm_run_text(run, (const char *)buf, (size_t)st.st_size);
+  }
+
+  munmap(buf, (size_t)st.st_size);
+
+  return 0;
+}
+
+static int fsm_run_stream(fsm_run_t *run, int fd) {
+
+  uint8_t *buf = (uint8_t *)aligned_alloc(sizeof(int), FSM_RUN_READ);
+  size_t pending = 0;
+
+  if (buf == NULL) {
+    return -1;
+  }
+
+  while (!run->done) {
+    ssize_t res = read(fd, buf + pending, FSM_RUN_READ - pending);
+    if (res < 0) {
+      perror("read");
+      free(buf);
+      return -1;
+    }
+    if (res == 0) {
+      break;
+    }
+    if (run->binary) {
+      size_t size = pending + (size_t)res;
+      size_t used = fsm_run_binary(run, buf, size);
+      pending = size - used;
+      memmove(buf, buf + used, pending);
+    } else {
+      fsm_run_text(run, (const char *)buf, (size_t)res);
+    }
+  }
+
+  if (run->binary) {
+    fsm_run_partial(run, pending);
+  }
+
+  free(buf);
+
+  return 0;
+}
+
+static double fsm_run_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+
+  const fsm_run_machine_t *machine = &machines[0];
+  const char *image_path = NULL;
+  const char *output = NULL;
+  fsm_image_t image;
+  unsigned image_flags = FSM_IMAGE_VERIFY;
+  bool binary = false;
+  bool trace = false;
+  bool stats = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "m:i:no:bts")) != -1) {
+    switch (opt) {
+    case 'm':
+      machine = NULL;
+      for (size_t i = 0; i < ARRAY_SIZE(machines); i++) {
+        if (!strcmp(machines[i].name, optarg)) {
+          machine = &machines[i];
+        }
+      }
+      if (machine == NULL) {
+        fprintf(stderr, "error: unknown machine `%s`\n", optarg);
+        return 2;
+      }
+      break;
+    case 'i':
+      image_path = optarg;
+      break;
+    case 'n':
+      image_flags &= ~FSM_IMAGE_VERIFY;
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'b':
+      binary = true;
+      break;
+    case 't':
+      trace = true;
+      break;
+    case 's':
+      stats = true;
+      break;
+    default:
+      fsm_run_usage(stderr);
+      return 2;
+    }
+  }
+
+  if (output) {
+    FILE *stream = fopen(output, "wb");
+    int res = stream ? fsm_image_write(stream, machine->name,
+                                       machine->state_list, NULL,
+                                       machine->event_list)
+                     : -1;
+    if (stream && fclose(stream)) {
+      res = -1;
+    }
+    if (res) {
+      fprintf(stderr, "error: cannot write `%s`\n", output);
+      return 1;
+    }
+    return 0;
+  }
+
+  if (image_path && fsm_image_map(&image, image_path, image_flags)) {
+    fprintf(stderr, "error: invalid image `%s`\n", image_path);
+    return 1;
+  }
+
+  fsm_run_t *run = (fsm_run_t *)calloc(1, sizeof(fsm_run_t));
+  fsm_waiter_t tracer = {.state = NULL, .resume = fsm_run_trace, .ctx = run};
+
+  if (run == NULL) {
+    return 1;
+  }
+
+  run->binary = binary;
+  run->trace = trace;
+
+  static char out[FSM_RUN_STDOUT];
+  setvbuf(stdout, out, _IOFBF, sizeof(out));
+
+  if (image_path) {
+    run->image = &image;
+    run->state = image.header->init_state;
+    if (trace) {
+      printf("%s\n", fsm_run_state_name(run));
+    }
+  } else {
+    fsm_init(&run->fsm, machine->name, machine->state_list, NULL,
+             machine->event_list);
+    if (trace) {
+      fsm_wait(&run->fsm, &tracer);
+    }
+  }
+
+  double start = fsm_run_now();
+  int res = optind < argc ? fsm_run_mapped(run, argv[optind])
+                          : fsm_run_stream(run, STDIN_FILENO);
+
+  if (!run->binary && run->name_length) {
+    fsm_run_name(run);
+  }
+  fsm_run_flush(run);
+
+  // an empty input still enters the initial state
+  fsm_run_dispatch(run, NULL, 0);
+
+  double elapsed = fsm_run_now() - start;
+
+  printf("%s\n", fsm_run_state_name(run));
+  fflush(stdout);
+
+  if (stats) {
+    fprintf(stderr,
+            "info: %zu events, %zu unknown, %zu partial bytes, %.3f s, "
+            "%.1f Mevents/s\n",
+            run->events, run->unknown, run->partial, elapsed,
+            elapsed > 0 ? (double)run->events / elapsed * 1e-6 : 0.0);
+  }
+
+  free(run);
+
+  if (image_path) {
+    fsm_image_unmap(&image);
+  }
+
+  return res ? 1 : 0;
+}